@@ -1044,6 +1044,7 @@ static actor_t s_mario_actor = {
     .x = 0,
     .y = 0,
     .frame = 0,
+    .priority = 0,
     .next_tick = 0,
     .animation = NULL,
     .flags = f_actor_none,
@@ -1055,6 +1056,7 @@ static actor_t s_pauline_actor = {
     .x = 0,
     .y = 0,
     .frame = 0,
+    .priority = 0,
     .next_tick = 0,
     .animation = NULL,
     .flags = f_actor_none,
@@ -1066,6 +1068,7 @@ static actor_t s_bonus_actor = {
     .x = 0,
     .y = 0,
     .frame = 0,
+    .priority = 1,
     .next_tick = 0,
     .animation = NULL,
     .flags = f_actor_none,
@@ -1077,6 +1080,7 @@ static actor_t s_oil_barrel_actor = {
     .x = 12,
     .y = 232,
     .frame = 0,
+    .priority = 0,
     .next_tick = 0,
     .flags = f_actor_none,
     .animation = &s_oil_barrel_anim,
@@ -1088,6 +1092,7 @@ static actor_t s_oil_fire_actor = {
     .x = 12,
     .y = 216,
     .frame = 0,
+    .priority = 0,
     .next_tick = 0,
     .flags = f_actor_none,
     .animation = &s_oil_fire_anim,
@@ -1099,6 +1104,7 @@ static actor_t s_donkey_kong_actor = {
     .x = 0,
     .y = 0,
     .frame = 0,
+    .priority = 0,
     .next_tick = 0,
     .animation = NULL,
     .flags = f_actor_none,
@@ -1110,6 +1116,7 @@ static actor_t s_heart_actor = {
     .x = 0,
     .y = 0,
     .frame = 0,
+    .priority = 0,
     .next_tick = 0,
     .animation = NULL,
     .flags = f_actor_none,
@@ -1142,7 +1149,7 @@ void actor_reset() {
 void actor_update(uint32_t ticks) {
     video_reset_sprites();
 
-    uint8_t sprite_number = 0;
+    uint32_t sprite_number = 0;
     for (uint32_t i = 0; ; i++) {
         actor_t* actor = s_actors[i];
         if (actor == NULL)
@@ -1158,11 +1165,14 @@ void actor_update(uint32_t ticks) {
         animation_frame_t* frame = &actor->animation->frames[actor->frame];
         for (uint32_t j = 0; j < frame->tile_count; j++) {
             animation_frame_tile_t* frame_tile = &frame->tiles[j];
-            spr_control_block_t* block = video_sprite(sprite_number++);
+            spr_control_block_t* block = video_sprite_virtual(sprite_number++);
+            if (block == NULL)
+                break;
             block->x = (uint16_t) (actor->x + frame_tile->x_offset);
             block->y = (uint16_t) (actor->y + frame_tile->y_offset);
             block->tile = frame_tile->tile;
             block->palette = frame_tile->palette;
+            block->priority = actor->priority;
             block->flags |= frame_tile->flags | f_spr_enabled;
         }
 
@@ -92,6 +92,7 @@ typedef struct actor {
     int16_t x;
     int16_t y;
     uint8_t frame;
+    int8_t priority;
     uint16_t data1;
     uint16_t data2;
     uint32_t next_tick;
@@ -0,0 +1,775 @@
+// --------------------------------------------------------------------------
+//
+// C Kong
+// Copyright (C) 2018 Jeff Panici
+// All rights reserved.
+//
+// This software source file is licensed according to the
+// MIT License.  Refer to the LICENSE file distributed along
+// with this source file to learn more.
+//
+// --------------------------------------------------------------------------
+
+#define SDL_MAIN_HANDLED
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL.h>
+#include "log.h"
+#include "blit.h"
+#include "tile.h"
+#include "video.h"
+#include "sprite.h"
+#include "palette.h"
+#include "pixel_format.h"
+#include "video_sink.h"
+
+typedef enum {
+    bench_format_csv,
+    bench_format_json,
+} bench_format_t;
+
+typedef enum {
+    bench_backend_null,
+    bench_backend_software,
+    bench_backend_window,
+} bench_backend_t;
+
+typedef struct {
+    const char* name;
+    uint32_t count;
+    const char* variant;
+    uint32_t iterations;
+    double ns_per_op;
+    double pixels_per_sec;
+} bench_result_t;
+
+typedef void (*bench_setup_t)(uint32_t count, uint8_t flags);
+typedef uint64_t (*bench_op_t)(uint32_t count, uint8_t flags, uint32_t ticks);
+
+#define BENCH_BLIT_COUNT (256)
+#define BENCH_BLIT_CLIPPED (0x80)
+#define BENCH_PLAYFIELD_ROWS (128)
+#define BENCH_SORT_BUDGET_NS (1000.0)
+#define BENCH_VERIFY_FRAMES (32)
+
+typedef enum {
+    bench_upscale_linear,
+    bench_upscale_nearest,
+    bench_upscale_blit,
+} bench_upscale_t;
+
+static const char* s_flip_names[] = {"none", "hflip", "vflip", "hvflip"};
+
+static const char* s_clip_names[] = {"none_clipped", "hflip_clipped", "vflip_clipped", "hvflip_clipped"};
+
+static const uint8_t s_flip_flags[] = {
+    f_spr_none,
+    f_spr_hflip,
+    f_spr_vflip,
+    f_spr_hflip | f_spr_vflip
+};
+
+static video_sink_t* s_sink;
+static window_t s_window;
+static SDL_Surface* s_surface;
+static tile_map_t s_maps[2];
+static tile_map_entry_t s_playfield[BENCH_PLAYFIELD_ROWS * TILE_MAP_WIDTH];
+static uint32_t s_iterations = 500;
+static bench_format_t s_format = bench_format_csv;
+static uint32_t s_result_count = 0;
+
+static uint32_t s_seed = 0x1234567u;
+
+static uint32_t s_blit_pixels[SCREEN_WIDTH * SCREEN_HEIGHT];
+
+static SDL_Surface* s_scale_surface;
+static SDL_Renderer* s_scale_renderer;
+static SDL_Texture* s_scale_texture;
+
+static uint32_t bench_random(void) {
+    s_seed = s_seed * 1103515245u + 12345u;
+    return s_seed >> 8;
+}
+
+static void bench_emit(const bench_result_t* result) {
+    if (s_format == bench_format_csv) {
+        if (s_result_count == 0)
+            printf("name,count,variant,iterations,ns_per_op,pixels_per_sec\n");
+        printf(
+            "%s,%u,%s,%u,%.1f,%.0f\n",
+            result->name,
+            result->count,
+            result->variant,
+            result->iterations,
+            result->ns_per_op,
+            result->pixels_per_sec);
+    } else {
+        printf(
+            "%s{\"name\": \"%s\", \"count\": %u, \"variant\": \"%s\", "
+            "\"iterations\": %u, \"ns_per_op\": %.1f, \"pixels_per_sec\": %.0f}",
+            s_result_count == 0 ? "[\n  " : ",\n  ",
+            result->name,
+            result->count,
+            result->variant,
+            result->iterations,
+            result->ns_per_op,
+            result->pixels_per_sec);
+    }
+    s_result_count++;
+}
+
+static void bench_run(
+        const char* name,
+        uint32_t count,
+        const char* variant,
+        uint8_t flags,
+        bench_setup_t setup,
+        bench_op_t op) {
+    uint32_t ticks = 1000;
+
+    if (setup != NULL)
+        setup(count, flags);
+
+    // warm the caches and settle the dirty tracking before timing
+    for (uint32_t i = 0; i < 8; i++)
+        op(count, flags, ticks += MS_PER_FRAME);
+
+    uint64_t pixels = 0;
+    const uint64_t start = SDL_GetPerformanceCounter();
+    for (uint32_t i = 0; i < s_iterations; i++)
+        pixels += op(count, flags, ticks += MS_PER_FRAME);
+    const uint64_t elapsed = SDL_GetPerformanceCounter() - start;
+
+    const double seconds = (double) elapsed / (double) SDL_GetPerformanceFrequency();
+    bench_result_t result = {
+        .name = name,
+        .count = count,
+        .variant = variant,
+        .iterations = s_iterations,
+        .ns_per_op = seconds * 1e9 / s_iterations,
+        .pixels_per_sec = seconds > 0 ? (double) pixels / seconds : 0
+    };
+    bench_emit(&result);
+}
+
+static void bench_reset(uint32_t count, uint8_t flags) {
+    video_raster_clear();
+    video_bg_playfield(NULL, 0, 0);
+    video_scroll(0, 0);
+    video_bg_reset();
+    video_reset_sprites();
+    video_clip_rect_clear();
+    video_bg_set(&s_maps[0]);
+    video_update(s_sink, 0);
+}
+
+static uint64_t bench_bg_set(uint32_t count, uint8_t flags, uint32_t ticks) {
+    video_bg_set(&s_maps[ticks & 1]);
+    video_update(s_sink, ticks);
+    return TILE_MAP_SIZE * TILE_SIZE;
+}
+
+static uint64_t bench_palette(uint32_t count, uint8_t flags, uint32_t ticks) {
+    for (uint32_t i = 0; i < count; i++)
+        video_palette_changed((uint8_t) ((ticks + i) % PALETTE_MAX));
+    video_update(s_sink, ticks);
+    return (uint64_t) SCREEN_WIDTH * SCREEN_HEIGHT;
+}
+
+static void bench_sprites_setup(uint32_t count, uint8_t flags) {
+    bench_reset(count, flags);
+    for (uint32_t i = 0; i < count; i++) {
+        spr_control_block_t* block = video_sprite((uint8_t) i);
+        block->tile = (uint16_t) (bench_random() % SPRITE_MAX);
+        block->palette = (uint8_t) (bench_random() % PALETTE_MAX);
+        block->flags = (uint8_t) (f_spr_enabled | flags);
+    }
+}
+
+static uint64_t bench_sprites(uint32_t count, uint8_t flags, uint32_t ticks) {
+    for (uint32_t i = 0; i < count; i++) {
+        spr_control_block_t* block = video_sprite((uint8_t) i);
+        block->x = (uint16_t) (bench_random() % (SCREEN_WIDTH - SPRITE_WIDTH));
+        block->y = (uint16_t) (8 + bench_random() % (SCREEN_HEIGHT - SPRITE_HEIGHT - 8));
+    }
+    video_update(s_sink, ticks);
+    return (uint64_t) count * SPRITE_SIZE;
+}
+
+static void bench_virtual_setup(uint32_t count, uint8_t flags) {
+    bench_reset(count, flags);
+    for (uint32_t i = 0; i < count; i++) {
+        spr_control_block_t* block = video_sprite_virtual(i);
+        block->tile = (uint16_t) (bench_random() % SPRITE_MAX);
+        block->palette = (uint8_t) (bench_random() % PALETTE_MAX);
+        block->flags = f_spr_enabled;
+    }
+}
+
+// virtual sprites crowded into a few bands, so the multiplexer has to
+// drop & rotate them
+static uint64_t bench_virtual(uint32_t count, uint8_t flags, uint32_t ticks) {
+    for (uint32_t i = 0; i < count; i++) {
+        spr_control_block_t* block = video_sprite_virtual(i);
+        block->x = (uint16_t) (bench_random() % (SCREEN_WIDTH - SPRITE_WIDTH));
+        block->y = (uint16_t) (96 + bench_random() % 48);
+    }
+    video_update(s_sink, ticks);
+    return (uint64_t) count * SPRITE_SIZE;
+}
+
+static void bench_sort_setup(uint32_t count, uint8_t flags) {
+    static const int8_t priorities[] = {SPR_PRIORITY_BEHIND_BG, -1, 0, 0, 0, 1, 2, 127};
+
+    bench_reset(count, flags);
+    for (uint32_t i = 0; i < count; i++) {
+        spr_control_block_t* block = video_sprite((uint8_t) i);
+        block->priority = priorities[bench_random() % 8];
+        block->flags = f_spr_enabled;
+    }
+}
+
+static uint64_t bench_sort(uint32_t count, uint8_t flags, uint32_t ticks) {
+    uint32_t sorted;
+    video_sprite_sort(&sorted);
+    return sorted;
+}
+
+static bool bench_sort_verify(uint32_t count) {
+    uint32_t sorted;
+    spr_control_block_t* const* order = video_sprite_sort(&sorted);
+    if (sorted != count)
+        return false;
+    for (uint32_t i = 1; i < sorted; i++) {
+        const int8_t a = order[i - 1]->priority;
+        const int8_t b = order[i]->priority;
+        if (a > b || (a == b && order[i - 1] > order[i]))
+            return false;
+    }
+    return true;
+}
+
+#if defined(__OPTIMIZE__)
+// best batch of the sort; the mean over a run picks up whatever else the
+// machine was doing
+static double bench_sort_best(void) {
+    double best = 0;
+    for (uint32_t batch = 0; batch < 16; batch++) {
+        uint32_t sorted;
+        const uint64_t start = SDL_GetPerformanceCounter();
+        for (uint32_t i = 0; i < 256; i++)
+            video_sprite_sort(&sorted);
+        const uint64_t elapsed = SDL_GetPerformanceCounter() - start;
+
+        const double ns = (double) elapsed * 1e9 / (double) SDL_GetPerformanceFrequency() / 256;
+        if (batch == 0 || ns < best)
+            best = ns;
+    }
+    return best;
+}
+#endif
+
+static uint64_t bench_blit(uint32_t count, uint8_t flags, uint32_t ticks) {
+    blit_target_t target = {.pixels = (uint8_t*) s_blit_pixels, .pitch = SCREEN_WIDTH * 4};
+    blit_clip_t clip = {.x0 = 0, .y0 = 0, .x1 = SCREEN_WIDTH, .y1 = SCREEN_HEIGHT};
+    const uint8_t blit_flags = (uint8_t) (flags & (f_blit_hflip | f_blit_vflip));
+    for (uint32_t i = 0; i < count; i++) {
+        int32_t x = (int32_t) (bench_random() % (SCREEN_WIDTH - SPRITE_WIDTH));
+        if ((flags & BENCH_BLIT_CLIPPED) != 0) {
+            const int32_t overhang = (int32_t) (1 + bench_random() % (SPRITE_WIDTH - 1));
+            x = (i & 1) != 0 ? -overhang : SCREEN_WIDTH - SPRITE_WIDTH + overhang;
+        }
+        const int32_t y = (int32_t) (bench_random() % (SCREEN_HEIGHT - SPRITE_HEIGHT));
+        blit_sprite(
+            &target,
+            &clip,
+            x,
+            y,
+            (uint16_t) (i % SPRITE_MAX),
+            (uint8_t) (i % PALETTE_MAX),
+            blit_flags);
+    }
+    return (uint64_t) count * SPRITE_SIZE;
+}
+
+static void bench_upscale_free(void) {
+    if (s_scale_texture != NULL)
+        SDL_DestroyTexture(s_scale_texture);
+    if (s_scale_renderer != NULL)
+        SDL_DestroyRenderer(s_scale_renderer);
+    if (s_scale_surface != NULL)
+        SDL_FreeSurface(s_scale_surface);
+    s_scale_texture = NULL;
+    s_scale_renderer = NULL;
+    s_scale_surface = NULL;
+}
+
+static void bench_upscale_setup(uint32_t factor, uint8_t flags) {
+    bench_upscale_free();
+    for (uint32_t i = 0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i++)
+        s_blit_pixels[i] = bench_random();
+
+    s_scale_surface = SDL_CreateRGBSurfaceWithFormat(
+        0,
+        (int) (SCREEN_WIDTH * factor),
+        (int) (SCREEN_HEIGHT * factor),
+        32,
+        SDL_PIXELFORMAT_RGB888);
+    if (flags == bench_upscale_blit)
+        return;
+
+    // the window path: a streaming texture scaled by SDL_Renderer with
+    // a logical size, here on the software renderer.
+    SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, flags == bench_upscale_linear ? "linear" : "nearest");
+    s_scale_renderer = SDL_CreateSoftwareRenderer(s_scale_surface);
+    s_scale_texture = SDL_CreateTexture(
+        s_scale_renderer,
+        SDL_PIXELFORMAT_ARGB8888,
+        SDL_TEXTUREACCESS_STREAMING,
+        SCREEN_WIDTH,
+        SCREEN_HEIGHT);
+    SDL_RenderSetLogicalSize(s_scale_renderer, SCREEN_WIDTH, SCREEN_HEIGHT);
+}
+
+static uint64_t bench_upscale(uint32_t factor, uint8_t flags, uint32_t ticks) {
+    if (flags == bench_upscale_blit) {
+        const blit_target_t src = {.pixels = (uint8_t*) s_blit_pixels, .pitch = SCREEN_WIDTH * 4};
+        const blit_target_t dst = {.pixels = s_scale_surface->pixels, .pitch = s_scale_surface->pitch};
+        blit_scale(&dst, &src, SCREEN_WIDTH, SCREEN_HEIGHT, factor);
+    } else {
+        SDL_UpdateTexture(s_scale_texture, NULL, s_blit_pixels, SCREEN_WIDTH * 4);
+        SDL_RenderCopy(s_scale_renderer, s_scale_texture, NULL, NULL);
+        SDL_RenderPresent(s_scale_renderer);
+    }
+    return (uint64_t) SCREEN_WIDTH * SCREEN_HEIGHT * factor * factor;
+}
+
+static uint64_t bench_fill_rect(uint32_t count, uint8_t flags, uint32_t ticks) {
+    const color_t color = {.r = 0x2f, .g = 0x2f, .b = 0x2f, .a = 0xff};
+    for (uint32_t i = 0; i < count; i++) {
+        rect_t rect = {
+            .left = (int16_t) (bench_random() % (SCREEN_WIDTH - 32)),
+            .top = (int16_t) (bench_random() % (SCREEN_HEIGHT - 32)),
+            .width = 32,
+            .height = 32
+        };
+        video_fill_rect(color, rect);
+    }
+    video_update(s_sink, ticks);
+    return (uint64_t) count * 32 * 32;
+}
+
+static uint64_t bench_hline(uint32_t count, uint8_t flags, uint32_t ticks) {
+    const color_t color = {.r = 0xff, .g = 0xff, .b = 0xff, .a = 0xff};
+    for (uint32_t i = 0; i < count; i++)
+        video_hline(color, (uint16_t) (i % SCREEN_HEIGHT), 0, SCREEN_WIDTH);
+    video_update(s_sink, ticks);
+    return (uint64_t) count * SCREEN_WIDTH;
+}
+
+static void bench_scroll_setup(uint32_t count, uint8_t flags) {
+    bench_reset(count, flags);
+    video_bg_playfield(s_playfield, BENCH_PLAYFIELD_ROWS, TILE_MAP_WIDTH);
+    video_update(s_sink, 0);
+}
+
+static uint64_t bench_scroll(uint32_t count, uint8_t flags, uint32_t ticks) {
+    video_scroll((int32_t) (ticks / MS_PER_FRAME * count), 0);
+    video_update(s_sink, ticks);
+    return (uint64_t) SCREEN_WIDTH * SCREEN_HEIGHT;
+}
+
+static uint64_t bench_raster(uint32_t count, uint8_t flags, uint32_t ticks) {
+    // a wave over `count` lines starting mid-screen; the phase moves each frame
+    const uint32_t frame = ticks / MS_PER_FRAME;
+    for (uint32_t i = 0; i < count; i++) {
+        const uint32_t y = (SCREEN_HEIGHT / 2 + i) % SCREEN_HEIGHT;
+        const int16_t phase = (int16_t) ((frame + i) % 16);
+        video_raster_line((uint8_t) y, (int16_t) (phase < 8 ? phase : 16 - phase), flags != 0 ? 1 : -1);
+    }
+    video_update(s_sink, ticks);
+    return (uint64_t) count * SCREEN_WIDTH;
+}
+
+static void bench_blink_setup(uint32_t count, uint8_t flags) {
+    bench_reset(count, flags);
+    for (uint32_t i = 0; i < count; i++) {
+        video_bg_blink(
+            (uint8_t) (2 + (i % 8) * 3),
+            (uint8_t) ((i / 8) * 16),
+            2,
+            8,
+            0,
+            1,
+            NULL);
+    }
+}
+
+static uint64_t bench_blink(uint32_t count, uint8_t flags, uint32_t ticks) {
+    video_update(s_sink, ticks);
+    return (uint64_t) count * 2 * 8 * TILE_SIZE;
+}
+
+// a scripted scene through every banded path: bg sets & palette changes,
+// blinkers, edge-clipped & behind-bg sprites, virtual sprites crowding the
+// bands, fills & lines, then a scrolling playfield under raster lines.
+static void bench_verify_frame(uint32_t frame) {
+    static const int8_t priorities[] = {SPR_PRIORITY_BEHIND_BG, -1, 0, 0, 1, 127};
+    const color_t color = {.r = 0x5f, .g = 0x2f, .b = 0xaf, .a = 0xff};
+
+    if (frame == 0) {
+        video_raster_clear();
+        video_bg_playfield(NULL, 0, 0);
+        video_scroll(0, 0);
+        video_bg_reset();
+        video_reset_sprites();
+        video_clip_rect_clear();
+        video_bg_set(&s_maps[0]);
+        video_bg_blink(4, 8, 2, 8, 0, 1, NULL);
+    }
+    if (frame == 12)
+        video_bg_set(&s_maps[1]);
+    if (frame % 5 == 3)
+        video_palette_changed((uint8_t) (frame % PALETTE_MAX));
+
+    for (uint32_t i = 0; i < SPRITE_MAX; i++) {
+        spr_control_block_t* block = video_sprite((uint8_t) i);
+        block->x = (uint16_t) (bench_random() % SCREEN_WIDTH);
+        block->y = (uint16_t) (bench_random() % SCREEN_HEIGHT);
+        block->tile = (uint16_t) (bench_random() % SPRITE_MAX);
+        block->palette = (uint8_t) (bench_random() % PALETTE_MAX);
+        block->priority = priorities[bench_random() % 6];
+        block->flags = (uint8_t) (f_spr_enabled | s_flip_flags[bench_random() % 4]);
+    }
+    if (frame >= 20) {
+        for (uint32_t i = 0; i < SPRITE_MAX * 2; i++) {
+            spr_control_block_t* block = video_sprite_virtual(i);
+            block->x = (uint16_t) (bench_random() % (SCREEN_WIDTH - SPRITE_WIDTH));
+            block->y = (uint16_t) (96 + bench_random() % 48);
+            block->tile = (uint16_t) (bench_random() % SPRITE_MAX);
+            block->palette = (uint8_t) (bench_random() % PALETTE_MAX);
+            block->flags = f_spr_enabled;
+        }
+    }
+
+    for (uint32_t i = 0; i < 4; i++) {
+        rect_t rect = {
+            .left = (int16_t) (bench_random() % (SCREEN_WIDTH - 32)),
+            .top = (int16_t) (bench_random() % (SCREEN_HEIGHT - 32)),
+            .width = 32,
+            .height = 24
+        };
+        video_fill_rect(color, rect);
+        rect.top = (int16_t) (rect.top + 4);
+        video_rect(color, rect);
+    }
+    video_hline(color, (uint16_t) (frame * 7 % SCREEN_HEIGHT), 0, SCREEN_WIDTH);
+    video_vline(color, 0, (uint16_t) (frame * 11 % SCREEN_WIDTH), SCREEN_HEIGHT);
+
+    if (frame == 8)
+        video_bg_playfield(s_playfield, BENCH_PLAYFIELD_ROWS, TILE_MAP_WIDTH);
+    if (frame >= 8 && frame < 28)
+        video_scroll((int32_t) (frame * 5) - 40, (int32_t) (frame * 3));
+    if (frame >= 16 && frame < 28) {
+        for (uint32_t i = 0; i < 32; i++) {
+            const uint32_t y = (SCREEN_HEIGHT / 2 + i) % SCREEN_HEIGHT;
+            const int16_t phase = (int16_t) ((frame + i) % 16);
+            video_raster_line((uint8_t) y, (int16_t) (phase < 8 ? phase : 16 - phase), (i & 1) != 0 ? 1 : -1);
+        }
+    }
+    if (frame == 28) {
+        video_raster_clear();
+        video_bg_playfield(NULL, 0, 0);
+        video_scroll(0, 0);
+    }
+}
+
+static bool bench_bands_run(uint32_t threads, bool indexed, bool zero_copy, uint32_t* frames) {
+    video_sink_t* sink = video_sink_new(video_sink_memory, NULL);
+    video_render_threads(threads);
+    video_indexed(indexed);
+    video_zero_copy(zero_copy);
+
+    const uint32_t seed = s_seed;
+    s_seed = 0x2468aceu;
+    uint32_t ticks = 1000;
+    for (uint32_t f = 0; f < BENCH_VERIFY_FRAMES; f++) {
+        bench_verify_frame(f);
+        video_update(sink, ticks += MS_PER_FRAME);
+        memcpy(&frames[f * SCREEN_WIDTH * SCREEN_HEIGHT], sink->pixels, SCREEN_WIDTH * SCREEN_HEIGHT * 4);
+    }
+    s_seed = seed;
+
+    video_reset_sprites();
+    video_sink_free(sink);
+    return true;
+}
+
+// banded output must match the single-threaded path exactly, in rgba &
+// indexed modes, with and without zero-copy.
+static bool bench_bands_verify(uint32_t threads) {
+    static const char* s_mode_names[] = {"rgba", "indexed", "zero-copy", "indexed zero-copy"};
+
+    const size_t size = (size_t) BENCH_VERIFY_FRAMES * SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(uint32_t);
+    uint32_t* expected = malloc(size);
+    uint32_t* actual = malloc(size);
+    bool match = expected != NULL && actual != NULL;
+    for (uint32_t mode = 0; match && mode < 4; mode++) {
+        const bool indexed = (mode & 1) != 0;
+        const bool zero_copy = (mode & 2) != 0;
+        bench_bands_run(1, indexed, zero_copy, expected);
+        bench_bands_run(threads, indexed, zero_copy, actual);
+        for (uint32_t f = 0; f < BENCH_VERIFY_FRAMES; f++) {
+            const size_t offset = (size_t) f * SCREEN_WIDTH * SCREEN_HEIGHT;
+            if (memcmp(&expected[offset], &actual[offset], SCREEN_WIDTH * SCREEN_HEIGHT * 4) != 0) {
+                fprintf(stderr, "%s frame %u differs at %u threads.\n", s_mode_names[mode], f, threads);
+                match = false;
+                break;
+            }
+        }
+    }
+
+    free(expected);
+    free(actual);
+    return match;
+}
+
+static void bench_maps_init(void) {
+    for (uint32_t m = 0; m < 2; m++) {
+        for (uint32_t i = 0; i < TILE_MAP_SIZE; i++) {
+            tile_map_entry_t* entry = &s_maps[m].data[i];
+            entry->tile = (uint16_t) (bench_random() % 256);
+            entry->palette = (uint8_t) (bench_random() % PALETTE_MAX);
+            entry->flags = (uint8_t) ((bench_random() & 0x3) << 1);
+        }
+    }
+
+    for (uint32_t i = 0; i < BENCH_PLAYFIELD_ROWS * TILE_MAP_WIDTH; i++) {
+        s_playfield[i].tile = (uint16_t) (bench_random() % 256);
+        s_playfield[i].palette = (uint8_t) (bench_random() % PALETTE_MAX);
+        s_playfield[i].flags = (uint8_t) ((bench_random() & 0x3) << 1);
+    }
+}
+
+static bool bench_backend(bench_backend_t backend) {
+    if (backend == bench_backend_null) {
+        s_sink = video_sink_new(video_sink_null, NULL);
+        return true;
+    }
+
+    if (backend == bench_backend_software) {
+        s_surface = SDL_CreateRGBSurfaceWithFormat(
+            0,
+            SCREEN_WIDTH,
+            SCREEN_HEIGHT,
+            32,
+            SDL_PIXELFORMAT_ARGB8888);
+        s_window.renderer = SDL_CreateSoftwareRenderer(s_surface);
+    } else {
+        if (SDL_InitSubSystem(SDL_INIT_VIDEO) < 0)
+            return false;
+        s_window.window = SDL_CreateWindow(
+            "ckong_bench_video",
+            SDL_WINDOWPOS_UNDEFINED,
+            SDL_WINDOWPOS_UNDEFINED,
+            SCREEN_WIDTH,
+            SCREEN_HEIGHT,
+            SDL_WINDOW_HIDDEN);
+        if (s_window.window == NULL)
+            return false;
+        s_window.renderer = SDL_CreateRenderer(s_window.window, -1, SDL_RENDERER_ACCELERATED);
+    }
+
+    if (s_window.renderer == NULL)
+        return false;
+
+    SDL_RendererInfo info;
+    SDL_GetRendererInfo(s_window.renderer, &info);
+    fprintf(stderr, "renderer: %s\n", info.name);
+
+    s_window.format = pixel_format_negotiate(s_window.renderer);
+    s_window.texture = SDL_CreateTexture(
+        s_window.renderer,
+        s_window.format,
+        SDL_TEXTUREACCESS_STREAMING,
+        SCREEN_WIDTH,
+        SCREEN_HEIGHT);
+    s_sink = video_sink_new(video_sink_window, &s_window);
+    return s_window.texture != NULL;
+}
+
+static void bench_backend_free(void) {
+    video_sink_free(s_sink);
+    if (s_window.texture != NULL)
+        SDL_DestroyTexture(s_window.texture);
+    if (s_window.renderer != NULL)
+        SDL_DestroyRenderer(s_window.renderer);
+    if (s_window.window != NULL)
+        SDL_DestroyWindow(s_window.window);
+    if (s_surface != NULL)
+        SDL_FreeSurface(s_surface);
+}
+
+static void bench_usage(void) {
+    fprintf(
+        stderr,
+        "usage: ckong_bench_video [--json] [--iterations=N] [--threads=N] [--indexed]\n"
+        "                         [--renderer=cpu|atlas] [--backend=null|software|window]\n"
+        "                         [--zero-copy] [--verify]\n");
+}
+
+int main(int argc, char** argv) {
+    bool verify = false;
+    uint32_t threads = 1;
+    bool indexed = false;
+    bool zero_copy = false;
+    video_renderer_t renderer = video_renderer_cpu;
+    bench_backend_t backend = bench_backend_null;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            s_format = bench_format_json;
+        } else if (strcmp(argv[i], "--verify") == 0) {
+            verify = true;
+        } else if (strncmp(argv[i], "--iterations=", 13) == 0) {
+            s_iterations = (uint32_t) strtoul(argv[i] + 13, NULL, 10);
+            if (s_iterations == 0)
+                s_iterations = 1;
+        } else if (strcmp(argv[i], "--indexed") == 0) {
+            indexed = true;
+        } else if (strcmp(argv[i], "--zero-copy") == 0) {
+            zero_copy = true;
+        } else if (strncmp(argv[i], "--renderer=", 11) == 0) {
+            if (!video_renderer_parse(argv[i] + 11, &renderer)) {
+                bench_usage();
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--backend=null") == 0) {
+            backend = bench_backend_null;
+        } else if (strcmp(argv[i], "--backend=software") == 0) {
+            backend = bench_backend_software;
+        } else if (strcmp(argv[i], "--backend=window") == 0) {
+            backend = bench_backend_window;
+        } else if (strncmp(argv[i], "--threads=", 10) == 0) {
+            threads = (uint32_t) strtoul(argv[i] + 10, NULL, 10);
+        } else {
+            bench_usage();
+            return 1;
+        }
+    }
+
+    log_init();
+    if (SDL_Init(SDL_INIT_TIMER) < 0) {
+        fprintf(stderr, "SDL failed to initialize: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    if (!bench_backend(backend)) {
+        fprintf(stderr, "unable to create the render backend: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    video_init(s_window.renderer);
+    video_pixel_format(s_sink->format);
+    video_render_threads(threads);
+    video_indexed(indexed);
+    video_zero_copy(zero_copy);
+    if (renderer != video_renderer_cpu && !video_renderer(renderer)) {
+        fprintf(stderr, "renderer %s needs --backend=software or window.\n",
+                video_renderer_name(renderer));
+        return 1;
+    }
+
+    if (verify && !blit_verify()) {
+        fprintf(stderr, "blit kernels do not match the scalar path.\n");
+        return 1;
+    }
+
+    bench_maps_init();
+
+    if (verify && !bench_bands_verify(threads > 1 ? threads : 4)) {
+        fprintf(stderr, "banded frames do not match the single-threaded path.\n");
+        return 1;
+    }
+    video_render_threads(threads);
+    video_indexed(indexed);
+    video_zero_copy(zero_copy);
+
+    bench_run("bg_set", TILE_MAP_SIZE, "full", 0, bench_reset, bench_bg_set);
+    bench_run("palette_changed", 1, "bg_set", 0, bench_reset, bench_palette);
+    bench_run("palette_changed", 8, "bg_set", 0, bench_reset, bench_palette);
+
+    for (uint32_t f = 0; f < 4; f++) {
+        for (uint32_t count = 1; count <= SPRITE_MAX; count *= 2) {
+            bench_run(
+                "sprites",
+                count,
+                s_flip_names[f],
+                s_flip_flags[f],
+                bench_sprites_setup,
+                bench_sprites);
+        }
+    }
+
+    bench_run("sprite_sort", SPRITE_MAX, "radix", 0, bench_sort_setup, bench_sort);
+    if (verify && !bench_sort_verify(SPRITE_MAX)) {
+        fprintf(stderr, "sprite sort is not a stable priority order.\n");
+        return 1;
+    }
+    // the budget assumes an optimized build; -O0 code misses it by design
+#if defined(__OPTIMIZE__)
+    const double sort_ns = verify ? bench_sort_best() : 0;
+    if (sort_ns >= BENCH_SORT_BUDGET_NS) {
+        fprintf(stderr, "sprite sort took %.1f ns; the budget is %.0f ns.\n", sort_ns, BENCH_SORT_BUDGET_NS);
+        return 1;
+    }
+#endif
+
+    for (uint32_t count = SPRITE_MAX; count <= SPRITE_MAX * 8; count *= 2)
+        bench_run("sprites", count, "virtual", 0, bench_virtual_setup, bench_virtual);
+
+    for (uint8_t f = 0; f < 4; f++) {
+        bench_run("blit_sprite", BENCH_BLIT_COUNT, s_flip_names[f], f, NULL, bench_blit);
+        bench_run(
+            "blit_sprite",
+            BENCH_BLIT_COUNT,
+            s_clip_names[f],
+            (uint8_t) (f | BENCH_BLIT_CLIPPED),
+            NULL,
+            bench_blit);
+    }
+
+    for (uint32_t count = 16; count <= 4096; count *= 4) {
+        bench_run("fill_rect", count, "32x32", 0, bench_reset, bench_fill_rect);
+        bench_run("hline", count, "256", 0, bench_reset, bench_hline);
+    }
+
+    for (uint32_t count = 1; count <= TILE_HEIGHT; count *= 2)
+        bench_run("scroll", count, "playfield", 0, bench_scroll_setup, bench_scroll);
+
+    for (uint32_t count = 8; count <= SCREEN_HEIGHT; count *= 4) {
+        bench_run("raster", count, "hscroll", 0, bench_reset, bench_raster);
+        bench_run("raster", count, "hscroll_palette", 1, bench_reset, bench_raster);
+    }
+
+    for (uint32_t count = 1; count <= BLINKERS_MAX; count *= 4) {
+        bench_run("bg_blink", count, "2x8", 0, bench_blink_setup, bench_blink);
+    }
+
+    for (uint32_t factor = 2; factor <= 4; factor++) {
+        bench_run("upscale", factor, "sdl_linear", bench_upscale_linear, bench_upscale_setup, bench_upscale);
+        bench_run("upscale", factor, "sdl_nearest", bench_upscale_nearest, bench_upscale_setup, bench_upscale);
+        bench_run("upscale", factor, "blit_scale", bench_upscale_blit, bench_upscale_setup, bench_upscale);
+    }
+    bench_upscale_free();
+
+    if (s_format == bench_format_json)
+        printf("\n]\n");
+
+    video_shutdown();
+    bench_backend_free();
+    SDL_Quit();
+
+    return 0;
+}
@@ -0,0 +1,1015 @@
+// --------------------------------------------------------------------------
+//
+// C Kong
+// Copyright (C) 2018 Jeff Panici
+// All rights reserved.
+//
+// This software source file is licensed according to the
+// MIT License.  Refer to the LICENSE file distributed along
+// with this source file to learn more.
+//
+// --------------------------------------------------------------------------
+
+#include <string.h>
+#include <SDL_cpuinfo.h>
+#include "log.h"
+#include "blit.h"
+#include "sprite.h"
+#include "palette.h"
+#include "pixel_format.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define BLIT_X86 (1)
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define BLIT_TARGET(t) __attribute__((target(t)))
+#else
+#define BLIT_TARGET(t)
+#endif
+
+typedef void (*blit_row_fn)(uint32_t*, const uint32_t*, uint32_t, uint32_t);
+typedef void (*blit_span_fn)(uint32_t*, uint32_t, uint32_t);
+typedef void (*blit_scale_fn)(uint32_t*, const uint32_t*, uint32_t, uint32_t);
+
+// sprite pixel indexes, pre-flipped horizontally: [tile][hflip][y * width + x]
+static uint8_t s_sprite_rows[SPRITE_MAX][2][SPRITE_SIZE];
+
+// one bit per destination column for each palette index: [tile][hflip][y][index]
+static uint16_t s_sprite_masks[SPRITE_MAX][2][SPRITE_HEIGHT][4];
+
+// opaque runs (index != 0) of each sprite row, per hflip, with the
+// transparent border rows & columns trimmed away.
+typedef struct {
+    uint8_t x;
+    uint8_t count;
+} blit_run_t;
+
+typedef struct {
+    uint8_t top;
+    uint8_t bottom;
+    uint8_t left;
+    uint8_t right;
+    uint16_t rows[SPRITE_HEIGHT + 1];
+} blit_sprite_runs_t;
+
+static blit_sprite_runs_t s_sprite_runs[SPRITE_MAX][2];
+static blit_run_t s_runs[SPRITE_MAX * 2 * SPRITE_HEIGHT * (SPRITE_WIDTH / 2)];
+
+static uint32_t s_run_pixels = 0;
+
+static uint32_t s_lane_masks[16][4];
+
+static blit_kernel_t s_kernel = blit_kernel_scalar;
+
+static void blit_row_scalar(
+        uint32_t* dst,
+        const uint32_t* src,
+        uint32_t mask,
+        uint32_t count) {
+    for (uint32_t x = 0; x < count; x++, mask >>= 1) {
+        if ((mask & 1) != 0)
+            dst[x] = src[x];
+    }
+}
+
+#ifdef BLIT_X86
+BLIT_TARGET("sse2")
+static void blit_row_sse2(
+        uint32_t* dst,
+        const uint32_t* src,
+        uint32_t mask,
+        uint32_t count) {
+    uint32_t x = 0;
+    for (; x + 4 <= count; x += 4, mask >>= 4) {
+        const uint32_t bits = mask & 0x0f;
+        if (bits == 0)
+            continue;
+
+        __m128i s = _mm_loadu_si128((const __m128i*) (src + x));
+        if (bits == 0x0f) {
+            _mm_storeu_si128((__m128i*) (dst + x), s);
+            continue;
+        }
+
+        __m128i m = _mm_loadu_si128((const __m128i*) s_lane_masks[bits]);
+        __m128i d = _mm_loadu_si128((const __m128i*) (dst + x));
+        d = _mm_or_si128(_mm_and_si128(m, s), _mm_andnot_si128(m, d));
+        _mm_storeu_si128((__m128i*) (dst + x), d);
+    }
+
+    for (; x < count; x++, mask >>= 1) {
+        if ((mask & 1) != 0)
+            dst[x] = src[x];
+    }
+}
+
+BLIT_TARGET("avx2")
+static void blit_row_avx2(
+        uint32_t* dst,
+        const uint32_t* src,
+        uint32_t mask,
+        uint32_t count) {
+    // the source row is always SPRITE_WIDTH wide, so reading a full vector
+    // past count is safe; masked-out lanes are never written.
+    const __m256i select = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    for (uint32_t x = 0; x < count; x += 8, mask >>= 8) {
+        const uint32_t bits = mask & 0xff;
+        if (bits == 0)
+            continue;
+
+        __m256i s = _mm256_loadu_si256((const __m256i*) (src + x));
+        __m256i m = _mm256_and_si256(_mm256_set1_epi32((int) bits), select);
+        m = _mm256_cmpeq_epi32(m, select);
+        _mm256_maskstore_epi32((int*) (dst + x), m, s);
+    }
+}
+#endif
+
+static void blit_expand_scalar(
+        uint32_t* dst,
+        const uint8_t* src,
+        const uint32_t* lut,
+        uint32_t count) {
+    for (uint32_t x = 0; x < count; x++)
+        dst[x] = lut[src[x]];
+}
+
+#ifdef BLIT_X86
+BLIT_TARGET("avx2")
+static void blit_expand_avx2(
+        uint32_t* dst,
+        const uint8_t* src,
+        const uint32_t* lut,
+        uint32_t count) {
+    uint32_t x = 0;
+    for (; x + 8 <= count; x += 8) {
+        __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*) (src + x)));
+        __m256i color = _mm256_i32gather_epi32((const int*) lut, index, 4);
+        _mm256_storeu_si256((__m256i*) (dst + x), color);
+    }
+
+    for (; x < count; x++)
+        dst[x] = lut[src[x]];
+}
+#endif
+
+#ifdef BLIT_X86
+BLIT_TARGET("sse2")
+static void blit_row_indexed_sse2(uint8_t* dst, const uint8_t* src, uint32_t mask, uint8_t high) {
+    const __m128i select = _mm_setr_epi8(
+        1, 2, 4, 8, 16, 32, 64, (char) 128,
+        1, 2, 4, 8, 16, 32, 64, (char) 128);
+    __m128i m = _mm_unpacklo_epi64(
+        _mm_set1_epi8((char) (mask & 0xff)),
+        _mm_set1_epi8((char) (mask >> 8)));
+    m = _mm_cmpeq_epi8(_mm_and_si128(m, select), select);
+
+    __m128i s = _mm_or_si128(_mm_loadu_si128((const __m128i*) src), _mm_set1_epi8((char) high));
+    __m128i d = _mm_loadu_si128((const __m128i*) dst);
+    d = _mm_or_si128(_mm_and_si128(m, s), _mm_andnot_si128(m, d));
+    _mm_storeu_si128((__m128i*) dst, d);
+}
+#endif
+
+static void blit_span_scalar(uint32_t* dst, uint32_t color, uint32_t count) {
+    for (uint32_t x = 0; x < count; x++)
+        dst[x] = color;
+}
+
+#ifdef BLIT_X86
+BLIT_TARGET("sse2")
+static void blit_span_sse2(uint32_t* dst, uint32_t color, uint32_t count) {
+    const __m128i c = _mm_set1_epi32((int) color);
+    uint32_t x = 0;
+    for (; x + 4 <= count; x += 4)
+        _mm_storeu_si128((__m128i*) (dst + x), c);
+    for (; x < count; x++)
+        dst[x] = color;
+}
+
+BLIT_TARGET("avx2")
+static void blit_span_avx2(uint32_t* dst, uint32_t color, uint32_t count) {
+    const __m256i c = _mm256_set1_epi32((int) color);
+    uint32_t x = 0;
+    for (; x + 8 <= count; x += 8)
+        _mm256_storeu_si256((__m256i*) (dst + x), c);
+    for (; x < count; x++)
+        dst[x] = color;
+}
+#endif
+
+static void blit_scale_scalar(
+        uint32_t* dst,
+        const uint32_t* src,
+        uint32_t count,
+        uint32_t factor) {
+    for (uint32_t x = 0; x < count; x++) {
+        const uint32_t color = src[x];
+        for (uint32_t i = 0; i < factor; i++)
+            *dst++ = color;
+    }
+}
+
+#ifdef BLIT_X86
+BLIT_TARGET("sse2")
+static void blit_scale_sse2(
+        uint32_t* dst,
+        const uint32_t* src,
+        uint32_t count,
+        uint32_t factor) {
+    uint32_t x = 0;
+    switch (factor) {
+        case 2:
+            for (; x + 4 <= count; x += 4, dst += 8) {
+                const __m128i s = _mm_loadu_si128((const __m128i*) (src + x));
+                _mm_storeu_si128((__m128i*) dst, _mm_unpacklo_epi32(s, s));
+                _mm_storeu_si128((__m128i*) (dst + 4), _mm_unpackhi_epi32(s, s));
+            }
+            break;
+        case 3:
+            for (; x + 4 <= count; x += 4, dst += 12) {
+                const __m128i s = _mm_loadu_si128((const __m128i*) (src + x));
+                _mm_storeu_si128((__m128i*) dst, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 0, 0)));
+                _mm_storeu_si128((__m128i*) (dst + 4), _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 2, 1, 1)));
+                _mm_storeu_si128((__m128i*) (dst + 8), _mm_shuffle_epi32(s, _MM_SHUFFLE(3, 3, 3, 2)));
+            }
+            break;
+        case 4:
+            for (; x + 4 <= count; x += 4, dst += 16) {
+                const __m128i s = _mm_loadu_si128((const __m128i*) (src + x));
+                _mm_storeu_si128((__m128i*) dst, _mm_shuffle_epi32(s, _MM_SHUFFLE(0, 0, 0, 0)));
+                _mm_storeu_si128((__m128i*) (dst + 4), _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 1, 1, 1)));
+                _mm_storeu_si128((__m128i*) (dst + 8), _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 2, 2, 2)));
+                _mm_storeu_si128((__m128i*) (dst + 12), _mm_shuffle_epi32(s, _MM_SHUFFLE(3, 3, 3, 3)));
+            }
+            break;
+        default:
+            break;
+    }
+    blit_scale_scalar(dst, src + x, count - x, factor);
+}
+
+BLIT_TARGET("avx2")
+static void blit_scale_avx2(
+        uint32_t* dst,
+        const uint32_t* src,
+        uint32_t count,
+        uint32_t factor) {
+    uint32_t x = 0;
+    switch (factor) {
+        case 2: {
+            const __m256i lanes = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+            for (; x + 4 <= count; x += 4, dst += 8) {
+                const __m256i s = _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*) (src + x)));
+                _mm256_storeu_si256((__m256i*) dst, _mm256_permutevar8x32_epi32(s, lanes));
+            }
+            break;
+        }
+        case 3: {
+            const __m256i lanes = _mm256_setr_epi32(0, 0, 0, 1, 1, 1, 2, 2);
+            for (; x + 4 <= count; x += 4, dst += 12) {
+                const __m128i s = _mm_loadu_si128((const __m128i*) (src + x));
+                const __m256i wide = _mm256_castsi128_si256(s);
+                _mm256_storeu_si256((__m256i*) dst, _mm256_permutevar8x32_epi32(wide, lanes));
+                _mm_storeu_si128((__m128i*) (dst + 8), _mm_shuffle_epi32(s, _MM_SHUFFLE(3, 3, 3, 2)));
+            }
+            break;
+        }
+        case 4: {
+            const __m256i low = _mm256_setr_epi32(0, 0, 0, 0, 1, 1, 1, 1);
+            const __m256i high = _mm256_setr_epi32(2, 2, 2, 2, 3, 3, 3, 3);
+            for (; x + 4 <= count; x += 4, dst += 16) {
+                const __m256i s = _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*) (src + x)));
+                _mm256_storeu_si256((__m256i*) dst, _mm256_permutevar8x32_epi32(s, low));
+                _mm256_storeu_si256((__m256i*) (dst + 8), _mm256_permutevar8x32_epi32(s, high));
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    blit_scale_scalar(dst, src + x, count - x, factor);
+}
+#endif
+
+static blit_scale_fn blit_scale_row(blit_kernel_t kernel) {
+    switch (kernel) {
+#ifdef BLIT_X86
+        case blit_kernel_sse2:
+            return blit_scale_sse2;
+        case blit_kernel_avx2:
+            return blit_scale_avx2;
+#endif
+        default:
+            return blit_scale_scalar;
+    }
+}
+
+static blit_span_fn blit_span(blit_kernel_t kernel) {
+    switch (kernel) {
+#ifdef BLIT_X86
+        case blit_kernel_sse2:
+            return blit_span_sse2;
+        case blit_kernel_avx2:
+            return blit_span_avx2;
+#endif
+        default:
+            return blit_span_scalar;
+    }
+}
+
+static blit_row_fn blit_row(blit_kernel_t kernel) {
+    switch (kernel) {
+#ifdef BLIT_X86
+        case blit_kernel_sse2:
+            return blit_row_sse2;
+        case blit_kernel_avx2:
+            return blit_row_avx2;
+#endif
+        default:
+            return blit_row_scalar;
+    }
+}
+
+typedef struct {
+    int32_t px;
+    int32_t py;
+    int32_t x0;
+    int32_t x1;
+    int32_t y0;
+    int32_t y1;
+    uint16_t tile;
+    uint16_t keep[4];
+    uint32_t colors[4];
+    blit_row_fn row_fn;
+} blit_sprite_draw_t;
+
+typedef void (*blit_sprite_fn)(const blit_target_t*, const blit_sprite_draw_t*);
+
+// one sprite kernel per (clipped, hflip, vflip). flip & clip are compile
+// time constants in each expansion, so the unclipped variants drop the
+// skip, span & count bookkeeping and walk a constant SPRITE_WIDTH row.
+#define BLIT_SPRITE_VARIANT(name, H, V, CLIPPED)                                    \
+static void name(const blit_target_t* target, const blit_sprite_draw_t* draw) {      \
+    const uint32_t skip = CLIPPED ? (uint32_t) (draw->x0 - draw->px) : 0;           \
+    const uint32_t count = CLIPPED ? (uint32_t) (draw->x1 - draw->x0) : SPRITE_WIDTH; \
+    const uint32_t span = CLIPPED ? (1u << count) - 1 : 0xffffu;                    \
+    const uint16_t (*masks)[4] = s_sprite_masks[draw->tile][H];                     \
+    const uint8_t* rows = s_sprite_rows[draw->tile][H];                             \
+    const uint32_t* colors = draw->colors;                                          \
+    const uint16_t* keep = draw->keep;                                              \
+                                                                                    \
+    uint8_t* line = target->pixels + draw->y0 * target->pitch;                      \
+    uint32_t src[SPRITE_WIDTH];                                                     \
+    for (int32_t ty = draw->y0; ty < draw->y1; ty++, line += target->pitch) {       \
+        const uint32_t y = (uint32_t) (ty - draw->py);                              \
+        const uint32_t sy = V ? SPRITE_HEIGHT - 1 - y : y;                          \
+        const uint16_t* row_masks = masks[sy];                                      \
+        uint32_t mask = (uint32_t) ((row_masks[0] & keep[0])                        \
+            | (row_masks[1] & keep[1])                                              \
+            | (row_masks[2] & keep[2])                                              \
+            | (row_masks[3] & keep[3]));                                            \
+        if (CLIPPED)                                                                \
+            mask = (mask >> skip) & span;                                           \
+        if (mask == 0)                                                              \
+            continue;                                                               \
+                                                                                    \
+        const uint8_t* indexes = rows + sy * SPRITE_WIDTH + skip;                   \
+        uint32_t* dst = (uint32_t*) line + draw->x0;                                \
+        if (!CLIPPED && mask == 0xffffu) {                                          \
+            for (uint32_t x = 0; x < SPRITE_WIDTH; x++)                             \
+                dst[x] = colors[indexes[x]];                                        \
+            continue;                                                               \
+        }                                                                           \
+        for (uint32_t x = 0; x < count; x++)                                        \
+            src[x] = colors[indexes[x]];                                            \
+        draw->row_fn(dst, src, mask, count);                                        \
+    }                                                                               \
+}
+
+BLIT_SPRITE_VARIANT(blit_sprite_unclipped, 0, 0, false)
+BLIT_SPRITE_VARIANT(blit_sprite_unclipped_h, 1, 0, false)
+BLIT_SPRITE_VARIANT(blit_sprite_unclipped_v, 0, 1, false)
+BLIT_SPRITE_VARIANT(blit_sprite_unclipped_hv, 1, 1, false)
+BLIT_SPRITE_VARIANT(blit_sprite_clipped, 0, 0, true)
+BLIT_SPRITE_VARIANT(blit_sprite_clipped_h, 1, 0, true)
+BLIT_SPRITE_VARIANT(blit_sprite_clipped_v, 0, 1, true)
+BLIT_SPRITE_VARIANT(blit_sprite_clipped_hv, 1, 1, true)
+
+// draws only the opaque runs inside the trimmed bounds. valid when index
+// 0 is the palette's only transparent entry, which is how sprites are drawn.
+static void blit_sprite_runs(
+        const blit_target_t* target,
+        const blit_sprite_draw_t* draw,
+        uint32_t h,
+        bool vertical_flip) {
+    const blit_sprite_runs_t* runs = &s_sprite_runs[draw->tile][h];
+    const int32_t top = vertical_flip ? SPRITE_HEIGHT - runs->bottom : runs->top;
+    const int32_t bottom = vertical_flip ? SPRITE_HEIGHT - runs->top : runs->bottom;
+    const int32_t y0 = draw->py + top > draw->y0 ? draw->py + top : draw->y0;
+    const int32_t y1 = draw->py + bottom < draw->y1 ? draw->py + bottom : draw->y1;
+
+    const int32_t cx0 = draw->x0 - draw->px;
+    const int32_t cx1 = draw->x1 - draw->px;
+    const bool clipped = cx0 > runs->left || cx1 < runs->right;
+    const uint8_t* rows = s_sprite_rows[draw->tile][h];
+    const uint32_t* colors = draw->colors;
+
+    uint8_t* line = target->pixels + y0 * target->pitch;
+    for (int32_t ty = y0; ty < y1; ty++, line += target->pitch) {
+        const uint32_t y = (uint32_t) (ty - draw->py);
+        const uint32_t sy = vertical_flip ? SPRITE_HEIGHT - 1 - y : y;
+        const uint8_t* indexes = rows + sy * SPRITE_WIDTH;
+
+        for (uint32_t r = runs->rows[sy]; r < runs->rows[sy + 1]; r++) {
+            int32_t x = s_runs[r].x;
+            int32_t end = x + s_runs[r].count;
+            if (clipped) {
+                if (x < cx0)
+                    x = cx0;
+                if (end > cx1)
+                    end = cx1;
+            }
+
+            uint32_t* dst = (uint32_t*) line + (draw->px + x);
+            for (; x < end; x++)
+                *dst++ = colors[indexes[x]];
+        }
+    }
+}
+
+static uint32_t blit_compile_runs(uint16_t tile, uint32_t h, uint32_t offset) {
+    blit_sprite_runs_t* runs = &s_sprite_runs[tile][h];
+    const uint8_t* rows = s_sprite_rows[tile][h];
+
+    runs->top = SPRITE_HEIGHT;
+    runs->bottom = 0;
+    runs->left = SPRITE_WIDTH;
+    runs->right = 0;
+
+    uint32_t pixels = 0;
+    for (uint32_t y = 0; y < SPRITE_HEIGHT; y++) {
+        runs->rows[y] = (uint16_t) offset;
+
+        const uint8_t* indexes = rows + y * SPRITE_WIDTH;
+        uint32_t x = 0;
+        while (x < SPRITE_WIDTH) {
+            if (indexes[x] == 0) {
+                x++;
+                continue;
+            }
+
+            const uint32_t start = x;
+            while (x < SPRITE_WIDTH && indexes[x] != 0)
+                x++;
+
+            s_runs[offset].x = (uint8_t) start;
+            s_runs[offset].count = (uint8_t) (x - start);
+            offset++;
+            pixels += x - start;
+
+            if (start < runs->left)
+                runs->left = (uint8_t) start;
+            if (x > runs->right)
+                runs->right = (uint8_t) x;
+            if (y < runs->top)
+                runs->top = (uint8_t) y;
+            runs->bottom = (uint8_t) (y + 1);
+        }
+    }
+    runs->rows[SPRITE_HEIGHT] = (uint16_t) offset;
+
+    if (runs->top > runs->bottom)
+        runs->top = runs->bottom;
+
+    if (h == 0)
+        s_run_pixels += pixels;
+    return offset;
+}
+
+// [clipped][flags & (f_blit_hflip | f_blit_vflip)]
+static const blit_sprite_fn s_sprite_variants[2][4] = {
+    {blit_sprite_unclipped, blit_sprite_unclipped_h, blit_sprite_unclipped_v, blit_sprite_unclipped_hv},
+    {blit_sprite_clipped, blit_sprite_clipped_h, blit_sprite_clipped_v, blit_sprite_clipped_hv},
+};
+
+void blit_init(void) {
+    for (uint32_t m = 0; m < 16; m++) {
+        for (uint32_t i = 0; i < 4; i++)
+            s_lane_masks[m][i] = ((m >> i) & 1) != 0 ? 0xffffffffu : 0;
+    }
+
+    uint32_t offset = 0;
+    s_run_pixels = 0;
+    for (uint16_t tile = 0; tile < SPRITE_MAX; tile++) {
+        const sprite_bitmap_t* bitmap = sprite_bitmap(tile);
+        for (uint32_t h = 0; h < 2; h++) {
+            memset(s_sprite_masks[tile][h], 0, sizeof(s_sprite_masks[tile][h]));
+            for (uint32_t y = 0; y < SPRITE_HEIGHT; y++) {
+                for (uint32_t x = 0; x < SPRITE_WIDTH; x++) {
+                    const uint32_t sx = h != 0 ? SPRITE_WIDTH - 1 - x : x;
+                    const uint8_t index = (uint8_t) (bitmap->data[y * SPRITE_WIDTH + sx] & 0x03);
+                    s_sprite_rows[tile][h][y * SPRITE_WIDTH + x] = index;
+                    s_sprite_masks[tile][h][y][index] |= (uint16_t) (1u << x);
+                }
+            }
+            offset = blit_compile_runs(tile, h, offset);
+        }
+    }
+
+    log_message(
+        category_video,
+        "sprite runs: %d run(s), %d.%d pixels visited per sprite (was %d).",
+        offset,
+        s_run_pixels / SPRITE_MAX,
+        s_run_pixels * 10 / SPRITE_MAX % 10,
+        SPRITE_SIZE);
+
+    s_kernel = blit_kernel_scalar;
+    if (blit_kernel_supported(blit_kernel_avx2))
+        s_kernel = blit_kernel_avx2;
+    else if (blit_kernel_supported(blit_kernel_sse2))
+        s_kernel = blit_kernel_sse2;
+
+    log_message(category_video, "sprite blit kernel: %s.", blit_kernel_name(s_kernel));
+}
+
+bool blit_verify(void) {
+    static uint32_t s_expected[64 * 64];
+    static uint32_t s_actual[64 * 64];
+
+    const blit_clip_t clip = {.x0 = 2, .y0 = 3, .x1 = 62, .y1 = 61};
+    const int32_t positions[][2] = {{24, 24}, {-7, -3}, {55, 58}, {1, 40}};
+    const uint32_t position_count = sizeof(positions) / sizeof(positions[0]);
+
+    blit_target_t expected = {.pixels = (uint8_t*) s_expected, .pitch = 64 * 4};
+    blit_target_t actual = {.pixels = (uint8_t*) s_actual, .pitch = 64 * 4};
+
+    // compiled runs against the masked scalar path, on every build
+    for (uint16_t tile = 0; tile < SPRITE_MAX; tile++) {
+        for (uint16_t pal = 0; pal < PALETTE_MAX; pal++) {
+            for (uint8_t flags = 0; flags < 4; flags++) {
+                for (uint32_t i = 0; i < 64 * 64; i++)
+                    s_expected[i] = s_actual[i] = i * 2654435761u;
+
+                for (uint32_t p = 0; p < position_count; p++) {
+                    blit_sprite_kernel(
+                        blit_kernel_scalar,
+                        &expected,
+                        &clip,
+                        positions[p][0],
+                        positions[p][1],
+                        tile,
+                        (uint8_t) pal,
+                        flags);
+                    blit_sprite(
+                        &actual,
+                        &clip,
+                        positions[p][0],
+                        positions[p][1],
+                        tile,
+                        (uint8_t) pal,
+                        flags);
+                }
+
+                if (memcmp(s_expected, s_actual, sizeof(s_expected)) != 0) {
+                    log_error(
+                        category_video,
+                        "blit sprite runs mismatch: tile=%d, palette=%d, flags=%d",
+                        tile,
+                        pal,
+                        flags);
+                    return false;
+                }
+            }
+        }
+    }
+    log_message(category_video, "blit sprite runs match scalar output.");
+
+    for (blit_kernel_t kernel = blit_kernel_sse2; kernel < blit_kernel_max; kernel++) {
+        if (!blit_kernel_supported(kernel))
+            continue;
+
+        for (uint16_t tile = 0; tile < SPRITE_MAX; tile++) {
+            for (uint16_t pal = 0; pal < PALETTE_MAX; pal++) {
+                for (uint8_t flags = 0; flags < 4; flags++) {
+                    for (uint32_t i = 0; i < 64 * 64; i++)
+                        s_expected[i] = s_actual[i] = i * 2654435761u;
+
+                    for (uint32_t p = 0; p < position_count; p++) {
+                        blit_sprite_kernel(
+                            blit_kernel_scalar,
+                            &expected,
+                            &clip,
+                            positions[p][0],
+                            positions[p][1],
+                            tile,
+                            (uint8_t) pal,
+                            flags);
+                        blit_sprite_kernel(
+                            kernel,
+                            &actual,
+                            &clip,
+                            positions[p][0],
+                            positions[p][1],
+                            tile,
+                            (uint8_t) pal,
+                            flags);
+                    }
+
+                    if (memcmp(s_expected, s_actual, sizeof(s_expected)) != 0) {
+                        log_error(
+                            category_video,
+                            "blit kernel %s mismatch: tile=%d, palette=%d, flags=%d",
+                            blit_kernel_name(kernel),
+                            tile,
+                            pal,
+                            flags);
+                        return false;
+                    }
+                }
+            }
+        }
+
+        uint8_t* expected_indexes = (uint8_t*) s_expected;
+        uint8_t* actual_indexes = (uint8_t*) s_actual;
+        blit_target_t expected8 = {.pixels = expected_indexes, .pitch = 64};
+        blit_target_t actual8 = {.pixels = actual_indexes, .pitch = 64};
+        for (uint16_t tile = 0; tile < SPRITE_MAX; tile++) {
+            for (uint8_t flags = 0; flags < 4; flags++) {
+                memset(expected_indexes, 0x5a, 64 * 64);
+                memset(actual_indexes, 0x5a, 64 * 64);
+                for (uint32_t p = 0; p < position_count; p++) {
+                    const uint8_t pal = (uint8_t) ((tile + p) % PALETTE_MAX);
+                    blit_sprite_indexed_kernel(
+                        blit_kernel_scalar,
+                        &expected8,
+                        &clip,
+                        positions[p][0],
+                        positions[p][1],
+                        tile,
+                        pal,
+                        flags);
+                    blit_sprite_indexed_kernel(
+                        kernel,
+                        &actual8,
+                        &clip,
+                        positions[p][0],
+                        positions[p][1],
+                        tile,
+                        pal,
+                        flags);
+                }
+                if (memcmp(s_expected, s_actual, 64 * 64) != 0) {
+                    log_error(
+                        category_video,
+                        "blit kernel %s indexed mismatch: tile=%d, flags=%d",
+                        blit_kernel_name(kernel),
+                        tile,
+                        flags);
+                    return false;
+                }
+            }
+        }
+
+        const int32_t rects[][4] = {{0, 0, 64, 64}, {-5, 7, 20, 3}, {13, -2, 1, 70}, {30, 60, 41, 9}};
+        for (uint32_t r = 0; r < sizeof(rects) / sizeof(rects[0]); r++) {
+            for (uint32_t i = 0; i < 64 * 64; i++)
+                s_expected[i] = s_actual[i] = i * 2654435761u;
+            const int32_t* rect = rects[r];
+            blit_fill_kernel(blit_kernel_scalar, &expected, &clip, rect[0], rect[1], rect[2], rect[3], 0x11223344u);
+            blit_fill_kernel(kernel, &actual, &clip, rect[0], rect[1], rect[2], rect[3], 0x11223344u);
+            if (memcmp(s_expected, s_actual, sizeof(s_expected)) != 0) {
+                log_error(
+                    category_video,
+                    "blit kernel %s fill mismatch: rect=%d",
+                    blit_kernel_name(kernel),
+                    r);
+                return false;
+            }
+        }
+
+        uint32_t lut[256];
+        uint8_t indexes[64 * 64];
+        for (uint32_t i = 0; i < 256; i++)
+            lut[i] = i * 2654435761u;
+        for (uint32_t i = 0; i < 64 * 64; i++)
+            indexes[i] = (uint8_t) ((i * 7) ^ (i >> 3));
+
+        for (uint32_t count = 1; count <= 64 * 64; count = count * 3 + 1) {
+            blit_expand_kernel(blit_kernel_scalar, s_expected, indexes, lut, count);
+            blit_expand_kernel(kernel, s_actual, indexes, lut, count);
+            if (memcmp(s_expected, s_actual, count * sizeof(uint32_t)) != 0) {
+                log_error(
+                    category_video,
+                    "blit kernel %s expand mismatch: count=%d",
+                    blit_kernel_name(kernel),
+                    count);
+                return false;
+            }
+        }
+
+        for (uint32_t factor = 1; factor <= 4; factor++) {
+            const uint32_t width = 64 / factor - 1;
+            const uint32_t height = 64 / factor;
+            const blit_target_t source = {.pixels = (uint8_t*) lut, .pitch = 3 * 4};
+            memset(s_expected, 0, sizeof(s_expected));
+            memset(s_actual, 0, sizeof(s_actual));
+            blit_scale_kernel(blit_kernel_scalar, &expected, &source, width, height, factor);
+            blit_scale_kernel(kernel, &actual, &source, width, height, factor);
+            if (memcmp(s_expected, s_actual, sizeof(s_expected)) != 0) {
+                log_error(
+                    category_video,
+                    "blit kernel %s scale mismatch: factor=%d",
+                    blit_kernel_name(kernel),
+                    factor);
+                return false;
+            }
+        }
+
+        log_message(
+            category_video,
+            "blit kernel %s matches scalar output.",
+            blit_kernel_name(kernel));
+    }
+
+    return true;
+}
+
+blit_kernel_t blit_kernel(void) {
+    return s_kernel;
+}
+
+const char* blit_kernel_name(blit_kernel_t kernel) {
+    switch (kernel) {
+        case blit_kernel_scalar:
+            return "scalar";
+        case blit_kernel_sse2:
+            return "sse2";
+        case blit_kernel_avx2:
+            return "avx2";
+        default:
+            return "unknown";
+    }
+}
+
+bool blit_kernel_supported(blit_kernel_t kernel) {
+    switch (kernel) {
+        case blit_kernel_scalar:
+            return true;
+#ifdef BLIT_X86
+        case blit_kernel_sse2:
+            return SDL_HasSSE2() == SDL_TRUE;
+        case blit_kernel_avx2:
+            return SDL_HasAVX2() == SDL_TRUE;
+#endif
+        default:
+            return false;
+    }
+}
+
+// the masked row kernels draw any palette; sprites whose only transparent
+// entry is index 0 can take the compiled runs instead, whatever the kernel.
+static bool blit_sprite_draw(
+        blit_kernel_t kernel,
+        bool compiled,
+        const blit_target_t* target,
+        const blit_clip_t* clip,
+        int32_t px,
+        int32_t py,
+        uint16_t tile,
+        uint8_t pal_index,
+        uint8_t flags) {
+    const palette_t* pal = palette(pal_index);
+    if (pal == NULL || tile >= SPRITE_MAX)
+        return false;
+
+    const int32_t x0 = px > clip->x0 ? px : clip->x0;
+    const int32_t x1 = px + SPRITE_WIDTH < clip->x1 ? px + SPRITE_WIDTH : clip->x1;
+    const int32_t y0 = py > clip->y0 ? py : clip->y0;
+    const int32_t y1 = py + SPRITE_HEIGHT < clip->y1 ? py + SPRITE_HEIGHT : clip->y1;
+    if (x0 >= x1 || y0 >= y1)
+        return true;
+
+    blit_sprite_draw_t draw = {
+        .px = px,
+        .py = py,
+        .x0 = x0,
+        .x1 = x1,
+        .y0 = y0,
+        .y1 = y1,
+        .tile = tile,
+        .row_fn = blit_row(kernel)
+    };
+    const pixel_palette_t* native = pixel_format_palette(pal_index);
+    for (uint32_t i = 0; i < 4; i++) {
+        draw.colors[i] = native->colors[i];
+        draw.keep[i] = pal->entries[i].alpha != 0x00 ? 0xffffu : 0;
+    }
+
+    const bool runs = compiled
+        && draw.keep[0] == 0
+        && (draw.keep[1] & draw.keep[2] & draw.keep[3]) != 0;
+    if (runs) {
+        const uint32_t h = (flags & f_blit_hflip) != 0 ? 1 : 0;
+        blit_sprite_runs(target, &draw, h, (flags & f_blit_vflip) != 0);
+        return true;
+    }
+
+    // rows are clipped by the loop bounds in every variant; only a
+    // horizontal clip needs the masked, variable-width path.
+    const bool clipped = x0 != px || x1 != px + SPRITE_WIDTH;
+    s_sprite_variants[clipped ? 1 : 0][flags & (f_blit_hflip | f_blit_vflip)](target, &draw);
+
+    return true;
+}
+
+bool blit_sprite(
+        const blit_target_t* target,
+        const blit_clip_t* clip,
+        int32_t px,
+        int32_t py,
+        uint16_t tile,
+        uint8_t pal_index,
+        uint8_t flags) {
+    return blit_sprite_draw(s_kernel, true, target, clip, px, py, tile, pal_index, flags);
+}
+
+bool blit_sprite_kernel(
+        blit_kernel_t kernel,
+        const blit_target_t* target,
+        const blit_clip_t* clip,
+        int32_t px,
+        int32_t py,
+        uint16_t tile,
+        uint8_t pal_index,
+        uint8_t flags) {
+    return blit_sprite_draw(kernel, false, target, clip, px, py, tile, pal_index, flags);
+}
+
+bool blit_sprite_indexed(
+        const blit_target_t* target,
+        const blit_clip_t* clip,
+        int32_t px,
+        int32_t py,
+        uint16_t tile,
+        uint8_t pal_index,
+        uint8_t flags) {
+    return blit_sprite_indexed_kernel(s_kernel, target, clip, px, py, tile, pal_index, flags);
+}
+
+bool blit_sprite_indexed_kernel(
+        blit_kernel_t kernel,
+        const blit_target_t* target,
+        const blit_clip_t* clip,
+        int32_t px,
+        int32_t py,
+        uint16_t tile,
+        uint8_t pal_index,
+        uint8_t flags) {
+    const palette_t* pal = palette(pal_index);
+    if (pal == NULL || tile >= SPRITE_MAX)
+        return false;
+
+    uint32_t opaque = 0;
+    for (uint32_t i = 0; i < 4; i++) {
+        if (pal->entries[i].alpha != 0x00)
+            opaque |= 1u << i;
+    }
+
+    const int32_t x0 = px > clip->x0 ? px : clip->x0;
+    const int32_t x1 = px + SPRITE_WIDTH < clip->x1 ? px + SPRITE_WIDTH : clip->x1;
+    const int32_t y0 = py > clip->y0 ? py : clip->y0;
+    const int32_t y1 = py + SPRITE_HEIGHT < clip->y1 ? py + SPRITE_HEIGHT : clip->y1;
+    if (x0 >= x1 || y0 >= y1)
+        return true;
+
+    const uint32_t h = (flags & f_blit_hflip) != 0 ? 1 : 0;
+    const bool vertical_flip = (flags & f_blit_vflip) != 0;
+    const uint32_t skip = (uint32_t) (x0 - px);
+    const uint32_t count = (uint32_t) (x1 - x0);
+    const uint8_t high = (uint8_t) (pal_index << 2);
+
+    for (int32_t ty = y0; ty < y1; ty++) {
+        const uint32_t y = (uint32_t) (ty - py);
+        const uint32_t sy = vertical_flip ? SPRITE_HEIGHT - 1 - y : y;
+
+        const uint16_t* masks = s_sprite_masks[tile][h][sy];
+        uint32_t mask = 0;
+        for (uint32_t i = 0; i < 4; i++) {
+            if ((opaque & (1u << i)) != 0)
+                mask |= masks[i];
+        }
+        mask >>= skip;
+
+        const uint8_t* indexes = &s_sprite_rows[tile][h][sy * SPRITE_WIDTH + skip];
+        uint8_t* dst = target->pixels + ty * target->pitch + x0;
+#ifdef BLIT_X86
+        if (kernel != blit_kernel_scalar && count == SPRITE_WIDTH) {
+            blit_row_indexed_sse2(dst, indexes, mask, high);
+            continue;
+        }
+#endif
+        for (uint32_t x = 0; x < count; x++, mask >>= 1) {
+            if ((mask & 1) != 0)
+                dst[x] = high | indexes[x];
+        }
+    }
+
+    return true;
+}
+
+void blit_expand(uint32_t* dst, const uint8_t* src, const uint32_t* lut, uint32_t count) {
+    blit_expand_kernel(s_kernel, dst, src, lut, count);
+}
+
+void blit_expand_kernel(
+        blit_kernel_t kernel,
+        uint32_t* dst,
+        const uint8_t* src,
+        const uint32_t* lut,
+        uint32_t count) {
+#ifdef BLIT_X86
+    if (kernel == blit_kernel_avx2) {
+        blit_expand_avx2(dst, src, lut, count);
+        return;
+    }
+#endif
+    blit_expand_scalar(dst, src, lut, count);
+}
+
+void blit_fill(
+        const blit_target_t* target,
+        const blit_clip_t* clip,
+        int32_t x,
+        int32_t y,
+        int32_t w,
+        int32_t h,
+        uint32_t color) {
+    blit_fill_kernel(s_kernel, target, clip, x, y, w, h, color);
+}
+
+void blit_fill_kernel(
+        blit_kernel_t kernel,
+        const blit_target_t* target,
+        const blit_clip_t* clip,
+        int32_t x,
+        int32_t y,
+        int32_t w,
+        int32_t h,
+        uint32_t color) {
+    const int32_t x0 = x > clip->x0 ? x : clip->x0;
+    const int32_t x1 = x + w < clip->x1 ? x + w : clip->x1;
+    const int32_t y0 = y > clip->y0 ? y : clip->y0;
+    const int32_t y1 = y + h < clip->y1 ? y + h : clip->y1;
+    if (x0 >= x1 || y0 >= y1)
+        return;
+
+    const uint32_t count = (uint32_t) (x1 - x0);
+    uint8_t* row = target->pixels + y0 * target->pitch + x0 * 4;
+
+    if (count == 1) {
+        for (int32_t ty = y0; ty < y1; ty++, row += target->pitch)
+            *(uint32_t*) row = color;
+        return;
+    }
+
+    const blit_span_fn span_fn = blit_span(kernel);
+    for (int32_t ty = y0; ty < y1; ty++, row += target->pitch)
+        span_fn((uint32_t*) row, color, count);
+}
+
+void blit_scale(
+        const blit_target_t* dst,
+        const blit_target_t* src,
+        uint32_t width,
+        uint32_t height,
+        uint32_t factor) {
+    blit_scale_kernel(s_kernel, dst, src, width, height, factor);
+}
+
+void blit_scale_kernel(
+        blit_kernel_t kernel,
+        const blit_target_t* dst,
+        const blit_target_t* src,
+        uint32_t width,
+        uint32_t height,
+        uint32_t factor) {
+    if (factor == 0)
+        return;
+
+    const blit_scale_fn scale_fn = blit_scale_row(kernel);
+    const size_t row_bytes = (size_t) width * factor * 4;
+    const uint8_t* src_row = src->pixels;
+    uint8_t* dst_row = dst->pixels;
+    for (uint32_t y = 0; y < height; y++, src_row += src->pitch) {
+        // widen the source row once, then copy it down the remaining rows
+        scale_fn((uint32_t*) dst_row, (const uint32_t*) src_row, width, factor);
+        const uint8_t* first = dst_row;
+        dst_row += dst->pitch;
+        for (uint32_t i = 1; i < factor; i++, dst_row += dst->pitch)
+            memcpy(dst_row, first, row_bytes);
+    }
+}
@@ -0,0 +1,132 @@
+// --------------------------------------------------------------------------
+//
+// C Kong
+// Copyright (C) 2018 Jeff Panici
+// All rights reserved.
+//
+// This software source file is licensed according to the
+// MIT License.  Refer to the LICENSE file distributed along
+// with this source file to learn more.
+//
+// --------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+    blit_kernel_scalar,
+    blit_kernel_sse2,
+    blit_kernel_avx2,
+    blit_kernel_max
+} blit_kernel_t;
+
+typedef enum {
+    f_blit_none  = 0b00000000,
+    f_blit_hflip = 0b00000001,
+    f_blit_vflip = 0b00000010,
+} blit_flags_t;
+
+typedef struct {
+    int32_t x0;
+    int32_t y0;
+    int32_t x1;
+    int32_t y1;
+} blit_clip_t;
+
+typedef struct {
+    uint8_t* pixels;
+    int32_t pitch;
+} blit_target_t;
+
+void blit_init(void);
+
+bool blit_verify(void);
+
+blit_kernel_t blit_kernel(void);
+
+const char* blit_kernel_name(blit_kernel_t kernel);
+
+bool blit_kernel_supported(blit_kernel_t kernel);
+
+bool blit_sprite(
+    const blit_target_t* target,
+    const blit_clip_t* clip,
+    int32_t px,
+    int32_t py,
+    uint16_t tile,
+    uint8_t palette,
+    uint8_t flags);
+
+bool blit_sprite_kernel(
+    blit_kernel_t kernel,
+    const blit_target_t* target,
+    const blit_clip_t* clip,
+    int32_t px,
+    int32_t py,
+    uint16_t tile,
+    uint8_t palette,
+    uint8_t flags);
+
+bool blit_sprite_indexed(
+    const blit_target_t* target,
+    const blit_clip_t* clip,
+    int32_t px,
+    int32_t py,
+    uint16_t tile,
+    uint8_t palette,
+    uint8_t flags);
+
+bool blit_sprite_indexed_kernel(
+    blit_kernel_t kernel,
+    const blit_target_t* target,
+    const blit_clip_t* clip,
+    int32_t px,
+    int32_t py,
+    uint16_t tile,
+    uint8_t palette,
+    uint8_t flags);
+
+void blit_fill(
+    const blit_target_t* target,
+    const blit_clip_t* clip,
+    int32_t x,
+    int32_t y,
+    int32_t w,
+    int32_t h,
+    uint32_t color);
+
+void blit_fill_kernel(
+    blit_kernel_t kernel,
+    const blit_target_t* target,
+    const blit_clip_t* clip,
+    int32_t x,
+    int32_t y,
+    int32_t w,
+    int32_t h,
+    uint32_t color);
+
+void blit_expand(uint32_t* dst, const uint8_t* src, const uint32_t* lut, uint32_t count);
+
+void blit_expand_kernel(
+    blit_kernel_t kernel,
+    uint32_t* dst,
+    const uint8_t* src,
+    const uint32_t* lut,
+    uint32_t count);
+
+void blit_scale(
+    const blit_target_t* dst,
+    const blit_target_t* src,
+    uint32_t width,
+    uint32_t height,
+    uint32_t factor);
+
+void blit_scale_kernel(
+    blit_kernel_t kernel,
+    const blit_target_t* dst,
+    const blit_target_t* src,
+    uint32_t width,
+    uint32_t height,
+    uint32_t factor);
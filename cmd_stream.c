@@ -0,0 +1,110 @@
+// --------------------------------------------------------------------------
+//
+// C Kong
+// Copyright (C) 2018 Jeff Panici
+// All rights reserved.
+//
+// This software source file is licensed according to the
+// MIT License.  Refer to the LICENSE file distributed along
+// with this source file to learn more.
+//
+// --------------------------------------------------------------------------
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "cmd_stream.h"
+
+#define CMD_STREAM_INITIAL (4096)
+
+static uint32_t cmd_stream_align(uint32_t size) {
+    return (size + (CMD_STREAM_ALIGN - 1)) & ~(uint32_t) (CMD_STREAM_ALIGN - 1);
+}
+
+static bool cmd_stream_grow(cmd_stream_t* stream, uint32_t needed) {
+    if (needed > stream->limit)
+        return false;
+
+    uint32_t capacity = stream->capacity > 0 ? stream->capacity : CMD_STREAM_INITIAL;
+    while (capacity < needed)
+        capacity *= 2;
+    if (capacity > stream->limit)
+        capacity = stream->limit;
+
+    uint8_t* data = realloc(stream->data, capacity);
+    if (data == NULL)
+        abort();
+    stream->data = data;
+    stream->capacity = capacity;
+    return true;
+}
+
+void cmd_stream_init(cmd_stream_t* stream, uint32_t limit) {
+    assert(stream != NULL);
+
+    memset(stream, 0, sizeof(cmd_stream_t));
+    stream->limit = limit;
+}
+
+void cmd_stream_free(cmd_stream_t* stream) {
+    assert(stream != NULL);
+
+    free(stream->data);
+    cmd_stream_init(stream, stream->limit);
+}
+
+void cmd_stream_reset(cmd_stream_t* stream) {
+    stream->used = 0;
+    stream->last = 0;
+    stream->count = 0;
+}
+
+void cmd_stream_reset_stats(cmd_stream_t* stream) {
+    // records still queued count towards the next high-water mark
+    stream->overflows = 0;
+    stream->high_water = stream->used;
+}
+
+void cmd_stream_limit(cmd_stream_t* stream, uint32_t limit) {
+    // records already in the stream are kept; the cap applies to the next push
+    stream->limit = limit;
+}
+
+void* cmd_stream_push(cmd_stream_t* stream, uint16_t type, uint32_t size) {
+    const uint32_t record = cmd_stream_align((uint32_t) sizeof(cmd_header_t) + size);
+    const uint32_t needed = stream->used + record;
+    if (record > CMD_STREAM_RECORD_MAX
+            || (needed > stream->capacity && !cmd_stream_grow(stream, needed))) {
+        stream->overflows++;
+        return NULL;
+    }
+
+    cmd_header_t* header = (cmd_header_t*) (stream->data + stream->used);
+    header->type = type;
+    header->size = (uint16_t) record;
+
+    stream->last = stream->used;
+    stream->used = needed;
+    stream->count++;
+    if (stream->used > stream->high_water)
+        stream->high_water = stream->used;
+
+    return header + 1;
+}
+
+void* cmd_stream_last(cmd_stream_t* stream, uint16_t type) {
+    if (stream->count == 0)
+        return NULL;
+
+    cmd_header_t* header = (cmd_header_t*) (stream->data + stream->last);
+    return header->type == type ? header + 1 : NULL;
+}
+
+const cmd_header_t* cmd_stream_next(const cmd_stream_t* stream, uint32_t* offset) {
+    if (*offset >= stream->used)
+        return NULL;
+
+    const cmd_header_t* header = (const cmd_header_t*) (stream->data + *offset);
+    *offset += header->size;
+    return header;
+}
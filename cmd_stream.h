@@ -0,0 +1,53 @@
+// --------------------------------------------------------------------------
+//
+// C Kong
+// Copyright (C) 2018 Jeff Panici
+// All rights reserved.
+//
+// This software source file is licensed according to the
+// MIT License.  Refer to the LICENSE file distributed along
+// with this source file to learn more.
+//
+// --------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define CMD_STREAM_ALIGN (4)
+#define CMD_STREAM_RECORD_MAX (UINT16_MAX & ~(CMD_STREAM_ALIGN - 1))
+#define CMD_STREAM_PAYLOAD(header) ((const void*) ((header) + 1))
+
+typedef struct {
+    uint16_t type;
+    uint16_t size;
+} cmd_header_t;
+
+typedef struct {
+    uint8_t* data;
+    uint32_t used;
+    uint32_t last;
+    uint32_t count;
+    uint32_t limit;
+    uint32_t capacity;
+    // since the last cmd_stream_reset_stats
+    uint32_t overflows;
+    uint32_t high_water;
+} cmd_stream_t;
+
+void cmd_stream_free(cmd_stream_t* stream);
+
+void cmd_stream_reset(cmd_stream_t* stream);
+
+void cmd_stream_reset_stats(cmd_stream_t* stream);
+
+void cmd_stream_init(cmd_stream_t* stream, uint32_t limit);
+
+void cmd_stream_limit(cmd_stream_t* stream, uint32_t limit);
+
+void* cmd_stream_last(cmd_stream_t* stream, uint16_t type);
+
+void* cmd_stream_push(cmd_stream_t* stream, uint16_t type, uint32_t size);
+
+const cmd_header_t* cmd_stream_next(const cmd_stream_t* stream, uint32_t* offset);
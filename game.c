@@ -12,6 +12,7 @@
 
 #include <SDL.h>
 #include <ini.h>
+#include <string.h>
 #include <unistd.h>
 #include "str.h"
 #include "log.h"
@@ -27,9 +28,30 @@
 
 static config_t s_config = {
     .win_x = -1,
-    .win_y = -1
+    .win_y = -1,
+    .max_frames = 0,
+    .render_threads = 1,
+    .sprite_limit = 0,
+    .command_bytes = COMMAND_BYTES_DEFAULT,
+    .scale = SCALE_X,
+    .indexed = false,
+    .zero_copy = false,
+    .renderer = video_renderer_cpu,
+    .sink = video_sink_window
 };
 
+static video_sink_type_t s_sink_type = video_sink_window;
+
+static uint32_t s_render_threads = 1;
+
+static bool s_indexed = false;
+
+static bool s_zero_copy = false;
+
+static uint32_t s_scale = SCALE_X;
+
+static video_renderer_t s_renderer_type = video_renderer_cpu;
+
 static bool s_show_fps = true;
 
 static state_context_t s_state_context = {
@@ -52,6 +74,28 @@ static int config_handler(
         config->win_x = atoi(value);
     } else if (MATCH("window", "y")) {
         config->win_y = atoi(value);
+    } else if (MATCH("video", "sink")) {
+        if (!video_sink_parse(value, &config->sink)) {
+            log_warn(category_app, "unknown video sink in ckong.ini: %s", value);
+            return 0;
+        }
+    } else if (MATCH("video", "threads")) {
+        config->render_threads = (uint32_t) atoi(value);
+    } else if (MATCH("video", "sprite_limit")) {
+        config->sprite_limit = (uint8_t) atoi(value);
+    } else if (MATCH("video", "command_bytes")) {
+        config->command_bytes = (uint32_t) strtoul(value, NULL, 10);
+    } else if (MATCH("video", "scale")) {
+        config->scale = (uint32_t) atoi(value);
+    } else if (MATCH("video", "indexed")) {
+        config->indexed = atoi(value) != 0;
+    } else if (MATCH("video", "zero_copy")) {
+        config->zero_copy = atoi(value) != 0;
+    } else if (MATCH("video", "renderer")) {
+        if (!video_renderer_parse(value, &config->renderer)) {
+            log_warn(category_app, "unknown video renderer in ckong.ini: %s", value);
+            return 0;
+        }
     } else {
         return 0;
     }
@@ -71,6 +115,49 @@ const config_t* game_config() {
     return &s_config;
 }
 
+static bool game_config_args(int argc, char** argv) {
+    s_sink_type = s_config.sink;
+    s_render_threads = s_config.render_threads;
+    s_indexed = s_config.indexed;
+    s_zero_copy = s_config.zero_copy;
+    s_renderer_type = s_config.renderer;
+    s_scale = s_config.scale;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (strncmp(arg, "--sink=", 7) == 0) {
+            if (!video_sink_parse(arg + 7, &s_sink_type)) {
+                log_error(category_app, "unknown video sink: %s", arg + 7);
+                return false;
+            }
+        } else if (strncmp(arg, "--frames=", 9) == 0) {
+            s_config.max_frames = (uint32_t) strtoul(arg + 9, NULL, 10);
+        } else if (strncmp(arg, "--threads=", 10) == 0) {
+            s_render_threads = (uint32_t) strtoul(arg + 10, NULL, 10);
+        } else if (strncmp(arg, "--renderer=", 11) == 0) {
+            if (!video_renderer_parse(arg + 11, &s_renderer_type)) {
+                log_error(category_app, "unknown video renderer: %s", arg + 11);
+                return false;
+            }
+        } else if (strncmp(arg, "--scale=", 8) == 0) {
+            s_scale = (uint32_t) strtoul(arg + 8, NULL, 10);
+        } else if (strcmp(arg, "--indexed") == 0) {
+            s_indexed = true;
+        } else if (strcmp(arg, "--zero-copy") == 0) {
+            s_zero_copy = true;
+        } else {
+            log_warn(category_app, "ignoring unknown argument: %s", arg);
+        }
+    }
+
+    if (s_scale < 1 || s_scale > 4) {
+        log_warn(category_app, "scale must be 1-4; using %d.", SCALE_X);
+        s_scale = SCALE_X;
+    }
+
+    return true;
+}
+
 static bool should_quit(void) {
     SDL_Event e;
     while (SDL_PollEvent(&e) != 0) {
@@ -97,7 +184,9 @@ static bool should_quit(void) {
 game_context_t* game_context_new() {
     log_message(category_app, "create empty game_context_t");
     game_context_t* context = malloc(sizeof(game_context_t));
+    memset(&context->window, 0, sizeof(window_t));
     context->valid = false;
+    context->sink = NULL;
     context->joystick = NULL;
     context->messages = ll_new_node();
     return context;
@@ -108,6 +197,7 @@ bool game_run(game_context_t* context) {
 
     uint16_t fps = 0;
     uint16_t frame_count = 0;
+    uint32_t total_frames = 0;
     uint32_t last_time = SDL_GetTicks();
     uint32_t last_fps_time = last_time;
 
@@ -124,7 +214,7 @@ bool game_run(game_context_t* context) {
         if (s_show_fps)
             video_text(white, 2, 2, "FPS: %d", fps);
 
-        video_update(&context->window, frame_start_ticks);
+        video_update(context->sink, frame_start_ticks);
 
         uint32_t frame_duration = SDL_GetTicks() - frame_start_ticks;
 
@@ -137,6 +227,9 @@ bool game_run(game_context_t* context) {
 
         ++frame_count;
 
+        if (s_config.max_frames > 0 && ++total_frames >= s_config.max_frames)
+            break;
+
         if (frame_duration < MS_PER_FRAME) {
             SDL_Delay(MS_PER_FRAME - frame_duration);
         }
@@ -147,31 +240,52 @@ bool game_run(game_context_t* context) {
     return true;
 }
 
-bool game_init(game_context_t* context) {
+bool game_init(game_context_t* context, int argc, char** argv) {
     timer_init();
 
     game_config_load();
+    if (!game_config_args(argc, argv)) {
+        context->messages->data = str_clone("invalid command line");
+        return false;
+    }
+
+    const bool headless = s_sink_type != video_sink_window && s_sink_type != video_sink_scaled;
 
     log_message(category_app, "SDL_Init all the things.");
-    int sdl_result = SDL_Init(SDL_INIT_EVERYTHING);
+    int sdl_result = SDL_Init(headless ?
+        SDL_INIT_TIMER | SDL_INIT_EVENTS | SDL_INIT_GAMECONTROLLER :
+        SDL_INIT_EVERYTHING);
     if (sdl_result < 0) {
         context->messages->data = str_clone("SDL failed to initialize");
         return false;
     }
 
-    log_message(category_app, "Create application window.");
-    context->window = window_create(s_config.win_y, s_config.win_x);
-    if (!context->window.valid) {
-        return false;
+    if (!headless) {
+        log_message(category_app, "Create application window.");
+        context->window = s_sink_type == video_sink_scaled ?
+            window_create_surface(s_config.win_y, s_config.win_x, s_scale) :
+            window_create(s_config.win_y, s_config.win_x);
+        if (!context->window.valid) {
+            return false;
+        }
     }
 
+    context->sink = video_sink_new(s_sink_type, &context->window);
+
     machine_init();
     machine_load();
 
     tile_map_init();
     tile_map_load();
 
-    video_init(context->window.renderer);
+    video_init(context->sink->renderer);
+    video_pixel_format(context->sink->format);
+    video_render_threads(s_render_threads);
+    video_sprite_limit(s_config.sprite_limit);
+    video_command_limit(s_config.command_bytes);
+    video_indexed(s_indexed);
+    video_zero_copy(s_zero_copy);
+    video_renderer(s_renderer_type);
 
     log_message(category_app, "connect to joystick.");
     context->joystick = joystick_open();
@@ -207,6 +321,9 @@ void game_shutdown(game_context_t* context) {
 
     video_shutdown();
 
+    log_message(category_app, "free video sink.");
+    video_sink_free(context->sink);
+
     log_message(category_app, "destroy streaming texture.");
     if (context->window.texture != NULL)
         SDL_DestroyTexture(context->window.texture);
@@ -228,8 +345,10 @@ void game_shutdown(game_context_t* context) {
 }
 
 bool game_config_save(const game_context_t* context) {
-    int x, y;
-    SDL_GetWindowPosition(context->window.window, &x, &y);
+    int x = s_config.win_x;
+    int y = s_config.win_y;
+    if (context->window.window != NULL)
+        SDL_GetWindowPosition(context->window.window, &x, &y);
 
     FILE* file = fopen("ckong.ini", "wt");
     if (file != NULL) {
@@ -237,6 +356,15 @@ bool game_config_save(const game_context_t* context) {
         fprintf(file, "[window]\n");
         fprintf(file, "x = %d\n", x);
         fprintf(file, "y = %d\n", y);
+        fprintf(file, "\n[video]\n");
+        fprintf(file, "sink = %s\n", video_sink_name(s_config.sink));
+        fprintf(file, "threads = %d\n", s_config.render_threads);
+        fprintf(file, "sprite_limit = %d\n", s_config.sprite_limit);
+        fprintf(file, "command_bytes = %d\n", s_config.command_bytes);
+        fprintf(file, "scale = %d\n", s_config.scale);
+        fprintf(file, "indexed = %d\n", s_config.indexed ? 1 : 0);
+        fprintf(file, "zero_copy = %d\n", s_config.zero_copy ? 1 : 0);
+        fprintf(file, "renderer = %s\n", video_renderer_name(s_config.renderer));
         return true;
     }
 
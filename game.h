@@ -13,20 +13,32 @@
 #pragma once
 
 #include <stdbool.h>
+#include "video.h"
 #include "window.h"
 #include "joystick.h"
+#include "video_sink.h"
 #include "linked_list.h"
 
 typedef struct  {
     bool valid;
     window_t window;
     ll_node_t* messages;
+    video_sink_t* sink;
     joystick_t* joystick;
 } game_context_t;
 
 typedef struct {
     int32_t win_x;
     int32_t win_y;
+    uint32_t max_frames;
+    uint32_t render_threads;
+    uint8_t sprite_limit;
+    uint32_t command_bytes;
+    uint32_t scale;
+    bool indexed;
+    bool zero_copy;
+    video_renderer_t renderer;
+    video_sink_type_t sink;
 } config_t;
 
 bool game_config_load();
@@ -37,7 +49,7 @@ game_context_t* game_context_new();
 
 bool game_run(game_context_t* context);
 
-bool game_init(game_context_t* context);
+bool game_init(game_context_t* context, int argc, char** argv);
 
 void game_shutdown(game_context_t* context);
 
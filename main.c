@@ -38,7 +38,7 @@ int main(int argc, char** argv) {
 
     game_context_t* context = game_context_new();
 
-    if (!game_init(context)) {
+    if (!game_init(context, argc, argv)) {
         log_messages(context->messages);
         log_messages(context->window.messages);
         rc = 1;
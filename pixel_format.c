@@ -0,0 +1,122 @@
+// --------------------------------------------------------------------------
+//
+// C Kong
+// Copyright (C) 2018 Jeff Panici
+// All rights reserved.
+//
+// This software source file is licensed according to the
+// MIT License.  Refer to the LICENSE file distributed along
+// with this source file to learn more.
+//
+// --------------------------------------------------------------------------
+
+#include <SDL_render.h>
+#include <SDL_pixels.h>
+#include "log.h"
+#include "palette.h"
+#include "pixel_format.h"
+
+static uint32_t s_format = SDL_PIXELFORMAT_UNKNOWN;
+
+static SDL_PixelFormat* s_pixel_format;
+
+static pixel_palette_t s_palettes[PALETTE_MAX];
+
+uint32_t pixel_format(void) {
+    return s_format;
+}
+
+uint32_t pixel_format_native(uint32_t format) {
+    // formats without alpha keep the same channel positions as their
+    // alpha twin, which then fills the unused byte.
+    switch (format) {
+        case SDL_PIXELFORMAT_ARGB8888:
+        case SDL_PIXELFORMAT_RGB888:
+            return SDL_PIXELFORMAT_ARGB8888;
+        case SDL_PIXELFORMAT_ABGR8888:
+        case SDL_PIXELFORMAT_BGR888:
+            return SDL_PIXELFORMAT_ABGR8888;
+        case SDL_PIXELFORMAT_RGBA8888:
+        case SDL_PIXELFORMAT_RGBX8888:
+            return SDL_PIXELFORMAT_RGBA8888;
+        case SDL_PIXELFORMAT_BGRA8888:
+        case SDL_PIXELFORMAT_BGRX8888:
+            return SDL_PIXELFORMAT_BGRA8888;
+        default:
+            return SDL_PIXELFORMAT_UNKNOWN;
+    }
+}
+
+uint32_t pixel_format_negotiate(SDL_Renderer* renderer) {
+    SDL_RendererInfo info;
+    if (renderer == NULL || SDL_GetRendererInfo(renderer, &info) != 0)
+        return SDL_PIXELFORMAT_ARGB8888;
+
+    // a listed alpha format is taken as is; otherwise the first listed
+    // 32-bit format decides the channel order.
+    uint32_t fallback = SDL_PIXELFORMAT_UNKNOWN;
+    for (uint32_t i = 0; i < info.num_texture_formats; i++) {
+        const uint32_t format = info.texture_formats[i];
+        const uint32_t native = pixel_format_native(format);
+        if (native == format)
+            return format;
+        if (fallback == SDL_PIXELFORMAT_UNKNOWN)
+            fallback = native;
+    }
+    return fallback != SDL_PIXELFORMAT_UNKNOWN ? fallback : SDL_PIXELFORMAT_ARGB8888;
+}
+
+uint32_t pixel_format_map(uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha) {
+    if (s_pixel_format == NULL)
+        pixel_format_set(SDL_PIXELFORMAT_ARGB8888);
+    return SDL_MapRGBA(s_pixel_format, red, green, blue, alpha);
+}
+
+void pixel_format_palette_changed(uint8_t pal_index) {
+    // pixel_format_set builds every palette once a format is chosen
+    if (pal_index >= PALETTE_MAX || s_pixel_format == NULL)
+        return;
+    const palette_t* pal = palette(pal_index);
+
+    // N.B. palette entries hold red & blue exchanged: frames used to be
+    // rgba bytes shown through an ARGB8888 texture, and the palettes were
+    // authored against what that put on screen.
+    pixel_palette_t* native = &s_palettes[pal_index];
+    for (uint32_t i = 0; i < 4; i++) {
+        const palette_entry_t* entry = &pal->entries[i];
+        native->colors[i] = pixel_format_map(entry->blue, entry->green, entry->red, entry->alpha);
+        native->opaque[i] = pixel_format_map(entry->blue, entry->green, entry->red, 0xff);
+    }
+}
+
+const pixel_palette_t* pixel_format_palette(uint8_t pal_index) {
+    if (pal_index >= PALETTE_MAX)
+        return NULL;
+    // drawing before video_init gets the format the window used to have
+    if (s_pixel_format == NULL)
+        pixel_format_set(SDL_PIXELFORMAT_ARGB8888);
+    return &s_palettes[pal_index];
+}
+
+void pixel_format_set(uint32_t format) {
+    uint32_t native = pixel_format_native(format);
+    if (native == SDL_PIXELFORMAT_UNKNOWN)
+        native = SDL_PIXELFORMAT_ARGB8888;
+    if (native == s_format)
+        return;
+
+    SDL_PixelFormat* pixel_format = SDL_AllocFormat(native);
+    if (pixel_format == NULL) {
+        log_error(category_video, "unable to allocate pixel format: %s", SDL_GetError());
+        return;
+    }
+    if (s_pixel_format != NULL)
+        SDL_FreeFormat(s_pixel_format);
+    s_pixel_format = pixel_format;
+    s_format = native;
+
+    for (uint32_t i = 0; i < PALETTE_MAX; i++)
+        pixel_format_palette_changed((uint8_t) i);
+
+    log_message(category_video, "pixel format: %s.", SDL_GetPixelFormatName(native));
+}
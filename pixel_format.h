@@ -0,0 +1,38 @@
+// --------------------------------------------------------------------------
+//
+// C Kong
+// Copyright (C) 2018 Jeff Panici
+// All rights reserved.
+//
+// This software source file is licensed according to the
+// MIT License.  Refer to the LICENSE file distributed along
+// with this source file to learn more.
+//
+// --------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+#include "fwd.h"
+
+// the 32-bit layout every frame pixel is drawn in, negotiated with the
+// renderer at startup; always one of the four 8-bit-per-channel formats
+// with alpha, so the draw loops never convert.
+typedef struct {
+    uint32_t colors[4];
+    uint32_t opaque[4];
+} pixel_palette_t;
+
+uint32_t pixel_format(void);
+
+void pixel_format_set(uint32_t format);
+
+uint32_t pixel_format_native(uint32_t format);
+
+void pixel_format_palette_changed(uint8_t palette);
+
+const pixel_palette_t* pixel_format_palette(uint8_t palette);
+
+uint32_t pixel_format_negotiate(struct SDL_Renderer* renderer);
+
+uint32_t pixel_format_map(uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha);
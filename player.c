@@ -43,7 +43,7 @@ void player1_header_update(uint32_t ticks) {
         bg_control_block_t* block = video_tile(3, (uint8_t) (1 + i));
         block->tile = 0xff;
         block->palette = 2;
-        block->flags |= f_bg_changed;
+        video_bg_mark(3, (uint8_t) (1 + i));
     }
 
     video_bg_str(3, 25, 2, true, "L=%02d", s_player1.level);
@@ -788,9 +788,11 @@ static bool how_high_enter(state_context_t* context) {
         for (uint8_t y = 5; y < e->row; y++) {
             for (uint8_t x = 7; x < 20; x++) {
                 bg_control_block_t* block = video_tile(y, x);
-                block->flags &= ~f_bg_enabled | f_bg_changed;
+                block->flags &= ~f_bg_enabled;
             }
         }
+        rect_t rect = {.left = 7, .top = 5, .width = 20 - 7, .height = (int16_t) (e->row - 5)};
+        video_bg_mark_rect(rect);
     }
 
     s_how_high_duration = timer_start(
@@ -1152,7 +1154,7 @@ static bool editor_enter(state_context_t* context) {
                 for (uint16_t x = 0; x < TILE_MAP_WIDTH; x++) {
                     bg_control_block_t* block = video_tile(s_tile_editor.y, x);
                     if (block != NULL) {
-                        block->flags |= f_bg_changed;
+                        video_bg_mark(s_tile_editor.y, (uint8_t) x);
                         block->tile = s_tile_editor.tile.value;
                         block->palette = s_tile_editor.palette.value;
                     }
@@ -1164,7 +1166,7 @@ static bool editor_enter(state_context_t* context) {
                 for (uint16_t y = 0; y < TILE_MAP_HEIGHT; y++) {
                     bg_control_block_t* block = video_tile(y, s_tile_editor.x);
                     if (block != NULL) {
-                        block->flags |= f_bg_changed;
+                        video_bg_mark((uint8_t) y, s_tile_editor.x);
                         block->tile = s_tile_editor.tile.value;
                         block->palette = s_tile_editor.palette.value;
                     }
@@ -1243,9 +1245,9 @@ static bool editor_update(state_context_t* context) {
             uint8_t ty = s_tile_editor.y;
             for (uint8_t y = 0; y < height; y++) {
                 for (uint8_t x = 0; x < width; x++) {
+                    video_bg_mark(ty, tx);
                     bg_control_block_t* target_block = video_tile(ty, tx++);
                     *target_block = s_tile_editor.copy_buffer[i++];
-                    target_block->flags |= f_bg_changed;
                 }
                 ++ty;
                 tx = s_tile_editor.x;
@@ -1288,7 +1290,7 @@ static bool editor_update(state_context_t* context) {
             bg_control_block_t* current_block = video_tile(s_tile_editor.y, x);
             bg_control_block_t* next_block = video_tile(s_tile_editor.y, x + 1);
             *current_block = *next_block;
-            current_block->flags |= f_bg_changed;
+            video_bg_mark(s_tile_editor.y, x);
         }
 
         *video_tile(s_tile_editor.y, TILE_MAP_WIDTH - 1) = last_block;
@@ -1301,7 +1303,7 @@ static bool editor_update(state_context_t* context) {
             bg_control_block_t* current_block = video_tile(s_tile_editor.y, x + 1);
             bg_control_block_t* prev_block = video_tile(s_tile_editor.y, x);
             *current_block = *prev_block;
-            current_block->flags |= f_bg_changed;
+            video_bg_mark(s_tile_editor.y, x + 1);
         }
 
         *video_tile(s_tile_editor.y, s_tile_editor.x) = start_block;
@@ -1310,7 +1312,7 @@ static bool editor_update(state_context_t* context) {
     if (s_tile_editor.text_entry) {
         if (key_pressed(SDL_SCANCODE_BACKSPACE)) {
             block->tile = 0x0a;
-            block->flags |= f_bg_changed;
+            video_bg_mark(s_tile_editor.y, s_tile_editor.x);
             if (s_tile_editor.x > 0)
                 s_tile_editor.x--;
         } else {
@@ -1331,7 +1333,7 @@ static bool editor_update(state_context_t* context) {
                         } else {
                             block->tile = (uint16_t) (c - 48);
                         }
-                        block->flags |= f_bg_changed;
+                        video_bg_mark(s_tile_editor.y, s_tile_editor.x);
                         block->palette = s_tile_editor.palette.value;
                     }
                     if (s_tile_editor.x < TILE_MAP_WIDTH - 1) {
@@ -1370,7 +1372,7 @@ static bool editor_update(state_context_t* context) {
         } else {
             block->flags |= f_bg_hflip;
         }
-        block->flags |= f_bg_changed;
+        video_bg_mark(s_tile_editor.y, s_tile_editor.x);
     }
 
     if (key_pressed(SDL_SCANCODE_F4)) {
@@ -1380,7 +1382,7 @@ static bool editor_update(state_context_t* context) {
         } else {
             block->flags |= f_bg_vflip;
         }
-        block->flags |= f_bg_changed;
+        video_bg_mark(s_tile_editor.y, s_tile_editor.x);
     }
 
     if (joystick_button_pressed(context->joystick, button_y)
@@ -1394,7 +1396,7 @@ static bool editor_update(state_context_t* context) {
     && !s_tile_editor.select_range) {
         bg_control_block_t* block = video_tile(s_tile_editor.y, s_tile_editor.x);
         if (block != NULL) {
-            block->flags |= f_bg_changed;
+            video_bg_mark(s_tile_editor.y, s_tile_editor.x);
             block->tile = s_tile_editor.tile.value;
             block->palette = s_tile_editor.palette.value;
         }
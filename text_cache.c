@@ -0,0 +1,199 @@
+// --------------------------------------------------------------------------
+//
+// C Kong
+// Copyright (C) 2018 Jeff Panici
+// All rights reserved.
+//
+// This software source file is licensed according to the
+// MIT License.  Refer to the LICENSE file distributed along
+// with this source file to learn more.
+//
+// --------------------------------------------------------------------------
+
+#include <string.h>
+#include <SDL_render.h>
+#include <SDL_FontCache.h>
+#include "log.h"
+#include "text_cache.h"
+
+#define TEXT_CACHE_LENGTH (256)
+
+typedef struct {
+    uint64_t hash;
+    uint64_t used;
+    int32_t x;
+    int32_t y;
+    int32_t w;
+    int32_t h;
+    color_t color;
+    SDL_Texture* texture;
+    char text[TEXT_CACHE_LENGTH];
+} text_cache_slot_t;
+
+static SDL_Renderer* s_renderer;
+
+static FC_Font* s_font;
+
+static bool s_targets = false;
+
+static uint64_t s_clock = 0;
+
+static text_cache_stats_t s_stats;
+
+static text_cache_slot_t s_slots[TEXT_CACHE_SLOTS];
+
+static uint64_t text_cache_hash(int32_t x, int32_t y, color_t color, const char* text) {
+    // FNV-1a over the position, color and string
+    uint64_t hash = 1469598103934665603ull;
+    const int32_t position[2] = {x, y};
+    const uint8_t* p = (const uint8_t*) position;
+    for (size_t i = 0; i < sizeof(position); i++)
+        hash = (hash ^ p[i]) * 1099511628211ull;
+    p = (const uint8_t*) &color;
+    for (size_t i = 0; i < sizeof(color_t); i++)
+        hash = (hash ^ p[i]) * 1099511628211ull;
+    for (p = (const uint8_t*) text; *p != 0; p++)
+        hash = (hash ^ *p) * 1099511628211ull;
+    return hash;
+}
+
+static bool text_cache_fits(const char* text) {
+    for (uint32_t i = 0; i < TEXT_CACHE_LENGTH; i++) {
+        if (text[i] == 0)
+            return true;
+    }
+    return false;
+}
+
+static void text_cache_free(text_cache_slot_t* slot) {
+    if (slot->texture != NULL)
+        SDL_DestroyTexture(slot->texture);
+    memset(slot, 0, sizeof(text_cache_slot_t));
+}
+
+static bool text_cache_render(text_cache_slot_t* slot) {
+    slot->w = FC_GetWidth(s_font, "%s", slot->text);
+    slot->h = FC_GetHeight(s_font, "%s", slot->text);
+    if (slot->w <= 0 || slot->h <= 0)
+        return false;
+
+    slot->texture = SDL_CreateTexture(
+        s_renderer,
+        SDL_PIXELFORMAT_RGBA8888,
+        SDL_TEXTUREACCESS_TARGET,
+        slot->w,
+        slot->h);
+    if (slot->texture == NULL)
+        return false;
+
+    SDL_BlendMode blend_mode;
+    SDL_GetRenderDrawBlendMode(s_renderer, &blend_mode);
+    SDL_Texture* target = SDL_GetRenderTarget(s_renderer);
+    SDL_SetRenderTarget(s_renderer, slot->texture);
+    SDL_SetRenderDrawBlendMode(s_renderer, SDL_BLENDMODE_NONE);
+    SDL_SetRenderDrawColor(s_renderer, 0, 0, 0, 0);
+    SDL_RenderClear(s_renderer);
+    FC_DrawColor(
+        s_font,
+        s_renderer,
+        0,
+        0,
+        FC_MakeColor(slot->color.r, slot->color.g, slot->color.b, slot->color.a),
+        "%s",
+        slot->text);
+    SDL_SetRenderTarget(s_renderer, target);
+    SDL_SetRenderDrawBlendMode(s_renderer, blend_mode);
+
+    SDL_SetTextureBlendMode(slot->texture, SDL_BLENDMODE_BLEND);
+    return true;
+}
+
+static text_cache_slot_t* text_cache_slot(
+        int32_t x,
+        int32_t y,
+        color_t color,
+        const char* text) {
+    const uint64_t hash = text_cache_hash(x, y, color, text);
+
+    text_cache_slot_t* victim = &s_slots[0];
+    for (uint32_t i = 0; i < TEXT_CACHE_SLOTS; i++) {
+        text_cache_slot_t* slot = &s_slots[i];
+        if (slot->texture != NULL
+                && slot->hash == hash
+                && slot->x == x
+                && slot->y == y
+                && memcmp(&slot->color, &color, sizeof(color_t)) == 0
+                && strcmp(slot->text, text) == 0) {
+            s_stats.hits++;
+            return slot;
+        }
+        if (slot->used < victim->used)
+            victim = slot;
+    }
+
+    s_stats.misses++;
+    if (victim->texture != NULL)
+        s_stats.evictions++;
+    text_cache_free(victim);
+
+    victim->hash = hash;
+    victim->x = x;
+    victim->y = y;
+    victim->color = color;
+    strncpy(victim->text, text, TEXT_CACHE_LENGTH - 1);
+    if (!text_cache_render(victim)) {
+        text_cache_free(victim);
+        return NULL;
+    }
+
+    return victim;
+}
+
+bool text_cache_init(struct SDL_Renderer* renderer, struct FC_Font* font) {
+    text_cache_shutdown();
+    if (renderer == NULL || font == NULL)
+        return false;
+
+    s_renderer = renderer;
+    s_font = font;
+    s_targets = SDL_RenderTargetSupported(renderer) == SDL_TRUE;
+    if (!s_targets)
+        log_warn(category_video, "no render targets; text is drawn uncached.");
+
+    return true;
+}
+
+void text_cache_flush(void) {
+    for (uint32_t i = 0; i < TEXT_CACHE_SLOTS; i++)
+        text_cache_free(&s_slots[i]);
+    memset(&s_stats, 0, sizeof(text_cache_stats_t));
+    s_clock = 0;
+}
+
+void text_cache_shutdown(void) {
+    text_cache_flush();
+    s_renderer = NULL;
+    s_font = NULL;
+    s_targets = false;
+}
+
+const text_cache_stats_t* text_cache_stats(void) {
+    return &s_stats;
+}
+
+void text_cache_draw(int32_t x, int32_t y, color_t color, const char* text) {
+    if (s_renderer == NULL)
+        return;
+
+    // strings the slot cannot hold whole would never match again
+    const bool cacheable = s_targets && text_cache_fits(text);
+    text_cache_slot_t* slot = cacheable ? text_cache_slot(x, y, color, text) : NULL;
+    if (slot == NULL) {
+        FC_DrawColor(s_font, s_renderer, x, y, FC_MakeColor(color.r, color.g, color.b, color.a), "%s", text);
+        return;
+    }
+
+    slot->used = ++s_clock;
+    SDL_Rect dst = {x, y, slot->w, slot->h};
+    SDL_RenderCopy(s_renderer, slot->texture, NULL, &dst);
+}
@@ -0,0 +1,38 @@
+// --------------------------------------------------------------------------
+//
+// C Kong
+// Copyright (C) 2018 Jeff Panici
+// All rights reserved.
+//
+// This software source file is licensed according to the
+// MIT License.  Refer to the LICENSE file distributed along
+// with this source file to learn more.
+//
+// --------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "fwd.h"
+#include "video.h"
+
+#define TEXT_CACHE_SLOTS (64)
+
+struct FC_Font;
+
+typedef struct {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+} text_cache_stats_t;
+
+void text_cache_flush(void);
+
+void text_cache_shutdown(void);
+
+const text_cache_stats_t* text_cache_stats(void);
+
+bool text_cache_init(struct SDL_Renderer* renderer, struct FC_Font* font);
+
+void text_cache_draw(int32_t x, int32_t y, color_t color, const char* text);
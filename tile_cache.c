@@ -0,0 +1,137 @@
+// --------------------------------------------------------------------------
+//
+// C Kong
+// Copyright (C) 2018 Jeff Panici
+// All rights reserved.
+//
+// This software source file is licensed according to the
+// MIT License.  Refer to the LICENSE file distributed along
+// with this source file to learn more.
+//
+// --------------------------------------------------------------------------
+
+#include <string.h>
+#include "palette.h"
+#include "pixel_format.h"
+#include "tile_cache.h"
+
+#define TILE_CACHE_EMPTY (0xffffffffu)
+#define TILE_CACHE_KEY(t, p, f) ((uint32_t) (t) | ((uint32_t) (p) << 16) | ((uint32_t) (f) << 24))
+
+typedef struct {
+    uint32_t key;
+    uint32_t pixels[TILE_SIZE];
+} tile_cache_slot_t;
+
+static tile_cache_stats_t s_stats;
+
+static tile_cache_slot_t s_slots[TILE_CACHE_SLOTS];
+
+static uint32_t tile_cache_index(uint32_t key) {
+    // fibonacci hash; (tile, palette, flip) keys are dense in the low bits
+    return (key * 2654435769u) >> (32 - TILE_CACHE_BITS);
+}
+
+static bool tile_cache_expand(
+        uint32_t* pixels,
+        uint16_t tile,
+        uint8_t palette_index,
+        uint8_t flags) {
+    const palette_t* pal = palette(palette_index);
+    if (pal == NULL)
+        return false;
+
+    const tile_bitmap_t* bitmap = tile_bitmap(tile);
+    if (bitmap == NULL)
+        return false;
+
+    const uint32_t* colors = pixel_format_palette(palette_index)->opaque;
+
+    const bool horizontal_flip = (flags & f_tile_cache_hflip) != 0;
+    const bool vertical_flip = (flags & f_tile_cache_vflip) != 0;
+
+    uint32_t* p = pixels;
+    for (uint32_t y = 0; y < TILE_HEIGHT; y++) {
+        const uint32_t sy = vertical_flip ? TILE_HEIGHT - 1 - y : y;
+        const uint8_t* row = &bitmap->data[sy * TILE_WIDTH];
+        for (uint32_t x = 0; x < TILE_WIDTH; x++) {
+            const uint32_t sx = horizontal_flip ? TILE_WIDTH - 1 - x : x;
+            *p++ = colors[row[sx] & 0x03];
+        }
+    }
+
+    return true;
+}
+
+void tile_cache_init(void) {
+    tile_cache_flush();
+}
+
+void tile_cache_flush(void) {
+    for (uint32_t i = 0; i < TILE_CACHE_SLOTS; i++)
+        s_slots[i].key = TILE_CACHE_EMPTY;
+    memset(&s_stats, 0, sizeof(tile_cache_stats_t));
+}
+
+const tile_cache_stats_t* tile_cache_stats(void) {
+    return &s_stats;
+}
+
+void tile_cache_invalidate_tile(uint16_t tile) {
+    for (uint32_t i = 0; i < TILE_CACHE_SLOTS; i++) {
+        tile_cache_slot_t* slot = &s_slots[i];
+        if (slot->key != TILE_CACHE_EMPTY && (slot->key & 0xffffu) == tile)
+            slot->key = TILE_CACHE_EMPTY;
+    }
+}
+
+void tile_cache_invalidate_palette(uint8_t palette) {
+    for (uint32_t i = 0; i < TILE_CACHE_SLOTS; i++) {
+        tile_cache_slot_t* slot = &s_slots[i];
+        if (slot->key != TILE_CACHE_EMPTY && ((slot->key >> 16) & 0xffu) == palette)
+            slot->key = TILE_CACHE_EMPTY;
+    }
+}
+
+const uint32_t* tile_cache_block(uint16_t tile, uint8_t palette, uint8_t flags) {
+    flags &= f_tile_cache_hflip | f_tile_cache_vflip;
+
+    const uint32_t key = TILE_CACHE_KEY(tile, palette, flags);
+    tile_cache_slot_t* slot = &s_slots[tile_cache_index(key)];
+    if (slot->key == key) {
+        s_stats.hits++;
+        return slot->pixels;
+    }
+
+    s_stats.misses++;
+    if (slot->key != TILE_CACHE_EMPTY)
+        s_stats.evictions++;
+
+    if (!tile_cache_expand(slot->pixels, tile, palette, flags)) {
+        slot->key = TILE_CACHE_EMPTY;
+        return NULL;
+    }
+
+    slot->key = key;
+    return slot->pixels;
+}
+
+const uint32_t* tile_cache_peek(
+        uint16_t tile,
+        uint8_t palette,
+        uint8_t flags,
+        uint32_t* scratch) {
+    flags &= f_tile_cache_hflip | f_tile_cache_vflip;
+
+    // N.B. never writes to the cache, so render workers may call this
+    // concurrently as long as nothing calls tile_cache_block meanwhile.
+    const uint32_t key = TILE_CACHE_KEY(tile, palette, flags);
+    const tile_cache_slot_t* slot = &s_slots[tile_cache_index(key)];
+    if (slot->key == key)
+        return slot->pixels;
+
+    if (!tile_cache_expand(scratch, tile, palette, flags))
+        return NULL;
+
+    return scratch;
+}
@@ -0,0 +1,50 @@
+// --------------------------------------------------------------------------
+//
+// C Kong
+// Copyright (C) 2018 Jeff Panici
+// All rights reserved.
+//
+// This software source file is licensed according to the
+// MIT License.  Refer to the LICENSE file distributed along
+// with this source file to learn more.
+//
+// --------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tile.h"
+
+#define TILE_CACHE_BITS (11)
+#define TILE_CACHE_SLOTS (1 << TILE_CACHE_BITS)
+
+typedef enum {
+    f_tile_cache_none  = 0b00000000,
+    f_tile_cache_hflip = 0b00000001,
+    f_tile_cache_vflip = 0b00000010,
+} tile_cache_flags_t;
+
+typedef struct {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+} tile_cache_stats_t;
+
+void tile_cache_init(void);
+
+void tile_cache_flush(void);
+
+void tile_cache_invalidate_tile(uint16_t tile);
+
+const tile_cache_stats_t* tile_cache_stats(void);
+
+void tile_cache_invalidate_palette(uint8_t palette);
+
+const uint32_t* tile_cache_block(uint16_t tile, uint8_t palette, uint8_t flags);
+
+const uint32_t* tile_cache_peek(
+    uint16_t tile,
+    uint8_t palette,
+    uint8_t flags,
+    uint32_t* scratch);
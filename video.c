@@ -11,37 +11,229 @@
 // --------------------------------------------------------------------------
 
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
 #include <SDL_timer.h>
+#include <SDL_render.h>
 #include <SDL_surface.h>
 #include <SDL_FontCache.h>
 #include "log.h"
+#include "blit.h"
 #include "tile.h"
 #include "video.h"
 #include "sprite.h"
 #include "window.h"
 #include "palette.h"
+#include "pixel_format.h"
 #include "tile_map.h"
+#include "tile_cache.h"
+#include "text_cache.h"
+#include "cmd_stream.h"
+#include "video_pool.h"
+#include "video_atlas.h"
+
+typedef struct {
+    uint16_t top;
+    uint16_t bottom;
+} vid_band_t;
 
 static rect_t s_clip_rect;
 
 static FC_Font* s_font;
 
+static SDL_Renderer* s_renderer;
+
+static video_renderer_t s_renderer_type = video_renderer_cpu;
+
+// atlas renderer: the bg is kept in a render target when supported
+static SDL_Texture* s_bg_target;
+
 static SDL_Surface* s_bg_surface;
 
 static SDL_Surface* s_fg_surface;
 
+// where the fg is composed this frame: s_fg_surface, or the sink's locked
+// texture rows when zero-copy streaming is enabled.
+static blit_target_t s_fg_target;
+static bool s_zero_copy = false;
+
 static bg_blinker_t s_blinkers[BLINKERS_MAX];
 static uint32_t s_current_blinker = 0;
 
-static vid_pre_command_t s_pre_commands[PRE_COMMANDS_MAX];
-static vid_post_command_t s_post_commands[POST_COMMANDS_MAX];
-static uint32_t s_current_pre_command = 0;
-static uint32_t s_current_post_command = 0;
+// per-frame command streams; records are packed & variable-size
+static cmd_stream_t s_pre_commands;
+static cmd_stream_t s_post_commands;
+static uint32_t s_command_limit = COMMAND_BYTES_DEFAULT;
 
 static spr_control_block_t s_spr_control[SPRITE_MAX];
 
+// 8x8 cells of s_fg_surface that sprites & pre-commands drew over this
+// frame, and the cells that must be restored from s_bg_surface next frame.
+static uint8_t s_fg_touched[TILE_MAP_SIZE];
+static uint8_t s_fg_restore[TILE_MAP_SIZE];
+
+// scanlines of s_fg_surface that changed this frame and must be uploaded
+static uint8_t s_fg_rows[SCREEN_HEIGHT];
+
+static video_stats_t s_stats;
+static uint32_t s_merged_fills = 0;
+
+// horizontal slices of the frame, each a whole number of tile rows, that
+// the render workers draw independently of one another.
+static vid_band_t s_bands[TILE_MAP_HEIGHT];
+static uint32_t s_band_count = 1;
+
+// bg cells whose tile changed and must be redrawn into s_bg_surface
+static uint8_t s_bg_redraw[TILE_MAP_SIZE];
+
+typedef struct {
+    blit_clip_t clip;
+    uint16_t rows;
+    const spr_control_block_t* block;
+} vid_spr_span_t;
+
+// virtual sprites: a growable list drawn alongside the control blocks and
+// multiplexed onto the per-band bucket slots. it grows a chunk of
+// SPRITE_MAX blocks at a time and chunks never move, so callers may keep
+// the blocks they were handed.
+#define SPR_VIRTUAL_CHUNKS (SPRITE_VIRTUAL_MAX / SPRITE_MAX)
+static spr_control_block_t* s_spr_chunks[SPR_VIRTUAL_CHUNKS];
+static uint32_t s_spr_virtual_count = 0;
+static uint32_t s_spr_virtual_capacity = 0;
+
+// visible part of each enabled sprite, bucketed by the 8-line rows it
+// covers; rows has one bit per sprite scanline the line limit allows.
+// each row holds at most SPRITE_MAX sprites; spans are sized for the
+// control blocks plus the virtual list.
+static vid_spr_span_t* s_spr_spans = NULL;
+static uint32_t s_spr_buckets[TILE_MAP_HEIGHT][SPRITE_MAX];
+static uint32_t s_spr_bucket_counts[TILE_MAP_HEIGHT];
+static uint8_t s_spr_line_counts[SCREEN_HEIGHT];
+static uint8_t s_spr_line_limit = 0;
+
+// first span left out of a full row last frame; the next frame hands out
+// row slots starting from it, so overflowing sprites flicker in turn.
+static uint32_t s_spr_flicker = 0;
+static uint32_t s_spr_overflow_frames = 0;
+static uint32_t s_spr_flickered_total = 0;
+
+// command stream peak & drops over the stats window; the per-frame values
+// are in s_stats.
+static uint32_t s_command_peak = 0;
+static uint32_t s_command_dropped = 0;
+
+// sprites in draw order: the enabled ones by ascending priority, control
+// blocks then the virtual list within a priority, then the disabled ones.
+// SPR_PRIORITY_BEHIND_BG sorts first.
+static spr_control_block_t** s_spr_order = NULL;
+
+// per-key counts for the sort, with disabled sprites under the last key;
+// the sort zeroes the keys it used before returning.
+#define SPR_KEY_DISABLED (256)
+static uint32_t s_spr_key_counts[SPR_KEY_DISABLED + 1];
+
+// indexed mode: tiles & sprites write (palette << 2) | color bytes, and
+// s_fg_indexes is expanded through s_index_colors into s_fg_surface.
+static bool s_indexed = false;
+static bool s_index_colors_changed = false;
+static uint32_t s_index_colors[256];
+static uint8_t s_bg_indexes[SCREEN_WIDTH * SCREEN_HEIGHT];
+static uint8_t s_fg_indexes[SCREEN_WIDTH * SCREEN_HEIGHT];
+
+// cells of s_fg_indexes that changed and must be expanded this frame
+static uint8_t s_fg_expand[TILE_MAP_SIZE];
+
+// tile color indexes for each flip combination: [tile][flags][y * width + x]
+static uint8_t s_tile_indexes[TILE_MAX][4][TILE_SIZE];
+
 static bg_control_block_t s_bg_control[TILE_MAP_SIZE];
 
+// fully rendered bgs of the maps handed to video_bg_set, keyed by the map
+// pointer and checked against a copy of its entries; `pixels` holds either
+// the rgba surface or the index buffer, whichever mode rendered it.
+typedef struct {
+    const tile_map_t* source;
+    tile_map_t map;
+    bool indexed;
+    uint64_t palettes;
+    uint8_t* pixels;
+} vid_bg_cache_t;
+
+static vid_bg_cache_t s_bg_cache[TILE_MAP_MAX];
+static uint32_t s_bg_cache_next = 0;
+
+// scroll registers, in pixels. the bg surface is a ring: bg pixel (x, y)
+// is shown at screen ((x - scroll_x) & 255, (y - scroll_y) & 255).
+static int32_t s_scroll_x = 0;
+static int32_t s_scroll_y = 0;
+
+// an attached playfield replaces s_bg_control as the bg source; ring
+// slots are redrawn from it only as scrolling exposes them.
+static const tile_map_entry_t* s_playfield = NULL;
+static uint16_t s_playfield_rows = 0;
+static uint16_t s_playfield_cols = 0;
+static uint32_t s_ring_dirty[TILE_MAP_HEIGHT];
+
+// per-scanline raster effects, applied as the bg is composited into the
+// fg. s_raster_lines holds one bit per line of each cell row, so rows
+// without effects cost a single test.
+typedef struct {
+    int16_t scroll_x;
+    int16_t palette;
+} vid_raster_t;
+
+static vid_raster_t s_raster[SCREEN_HEIGHT];
+static uint8_t s_raster_lines[TILE_MAP_HEIGHT];
+
+// one dirty bit per bg cell, one word per row; render bands own whole
+// rows, so a band only ever writes its own words.
+static uint32_t s_bg_dirty[TILE_MAP_HEIGHT];
+
+static inline void video_bg_dirty(uint32_t index) {
+    s_bg_dirty[index / TILE_MAP_WIDTH] |= 1u << (index % TILE_MAP_WIDTH);
+}
+
+static inline uint32_t video_bg_ctz(uint32_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (uint32_t) __builtin_ctz(bits);
+#else
+    uint32_t n = 0;
+    while ((bits & 1) == 0) {
+        bits >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+// marks the fg cells that show bg cell `index` for restore; with a scroll
+// that is not cell aligned a bg cell straddles up to four fg cells.
+static void video_fg_restore_cell(uint32_t index) {
+    if (s_scroll_x == 0 && s_scroll_y == 0) {
+        s_fg_restore[index] = 1;
+        if (s_raster_lines[index / TILE_MAP_WIDTH] != 0)
+            memset(&s_fg_restore[index / TILE_MAP_WIDTH * TILE_MAP_WIDTH], 1, TILE_MAP_WIDTH);
+        return;
+    }
+
+    const uint32_t x = (index % TILE_MAP_WIDTH * TILE_WIDTH - (uint32_t) s_scroll_x) & (SCREEN_WIDTH - 1);
+    const uint32_t y = (index / TILE_MAP_WIDTH * TILE_HEIGHT - (uint32_t) s_scroll_y) & (SCREEN_HEIGHT - 1);
+    const uint32_t x0 = x / TILE_WIDTH;
+    const uint32_t x1 = ((x + TILE_WIDTH - 1) & (SCREEN_WIDTH - 1)) / TILE_WIDTH;
+    const uint32_t y0 = y / TILE_HEIGHT * TILE_MAP_WIDTH;
+    const uint32_t y1 = ((y + TILE_HEIGHT - 1) & (SCREEN_HEIGHT - 1)) / TILE_HEIGHT * TILE_MAP_WIDTH;
+    s_fg_restore[y0 + x0] = 1;
+    s_fg_restore[y0 + x1] = 1;
+    s_fg_restore[y1 + x0] = 1;
+    s_fg_restore[y1 + x1] = 1;
+
+    // shifted lines show this cell elsewhere on its row
+    if (s_raster_lines[y0 / TILE_MAP_WIDTH] != 0)
+        memset(&s_fg_restore[y0], 1, TILE_MAP_WIDTH);
+    if (s_raster_lines[y1 / TILE_MAP_WIDTH] != 0)
+        memset(&s_fg_restore[y1], 1, TILE_MAP_WIDTH);
+}
+
 void video_bg_str(
         uint8_t y,
         uint8_t x,
@@ -81,8 +273,10 @@ void video_bg_str(
         }
         if (!enabled)
             block->flags &= ~f_bg_enabled;
-        block->flags |= f_bg_changed;
     }
+
+    rect_t rect = {.left = x, .top = y, .width = (int16_t) length, .height = 1};
+    video_bg_mark_rect(rect);
 }
 
 bg_blinker_t* video_bg_blink(
@@ -117,101 +311,711 @@ void video_bg_reset(void) {
     for (uint32_t i = 0; i < TILE_MAP_SIZE; i++) {
         s_bg_control[i].tile = 0;
         s_bg_control[i].palette = 0;
-        s_bg_control[i].flags = f_bg_enabled | f_bg_changed;
+        s_bg_control[i].flags = f_bg_enabled;
+    }
+    memset(s_bg_dirty, 0xff, sizeof(s_bg_dirty));
+}
+
+static void video_fg_touch(int32_t x, int32_t y, int32_t w, int32_t h) {
+    int32_t x1 = x + w;
+    int32_t y1 = y + h;
+    if (x < 0)
+        x = 0;
+    if (y < 0)
+        y = 0;
+    if (x1 > SCREEN_WIDTH)
+        x1 = SCREEN_WIDTH;
+    if (y1 > SCREEN_HEIGHT)
+        y1 = SCREEN_HEIGHT;
+    if (x >= x1 || y >= y1)
+        return;
+
+    memset(&s_fg_rows[y], 1, (size_t) (y1 - y));
+
+    const int32_t cx0 = x / TILE_WIDTH;
+    const int32_t cx1 = (x1 - 1) / TILE_WIDTH;
+    const int32_t cy0 = y / TILE_HEIGHT;
+    const int32_t cy1 = (y1 - 1) / TILE_HEIGHT;
+    for (int32_t cy = cy0; cy <= cy1; cy++) {
+        uint8_t* cells = &s_fg_touched[cy * TILE_MAP_WIDTH];
+        for (int32_t cx = cx0; cx <= cx1; cx++)
+            cells[cx] = 1;
+    }
+}
+
+static void video_spr_clip(blit_clip_t* clip) {
+    // N.B. sprites keep the original clip semantics: the top edge of the
+    // clip rect is exclusive and the right edge is inclusive.
+    clip->x0 = s_clip_rect.left;
+    clip->y0 = s_clip_rect.top + 1;
+    clip->x1 = s_clip_rect.left + s_clip_rect.width + 1;
+    clip->y1 = s_clip_rect.top + s_clip_rect.height;
+    if (clip->x0 < 0)
+        clip->x0 = 0;
+    if (clip->y0 < 0)
+        clip->y0 = 0;
+    if (clip->x1 > SCREEN_WIDTH)
+        clip->x1 = SCREEN_WIDTH;
+    if (clip->y1 > SCREEN_HEIGHT)
+        clip->y1 = SCREEN_HEIGHT;
+}
+
+// grows the per-frame order & span arrays, then the virtual list into
+// them; on failure the capacity stays what the arrays can hold.
+static bool video_spr_reserve(uint32_t capacity) {
+    if (capacity <= s_spr_virtual_capacity && s_spr_order != NULL)
+        return true;
+
+    uint32_t grown = s_spr_virtual_capacity > 0 ? s_spr_virtual_capacity : SPRITE_MAX;
+    while (grown < capacity)
+        grown *= 2;
+
+    spr_control_block_t** order = realloc(s_spr_order, (SPRITE_MAX + grown) * sizeof(spr_control_block_t*));
+    if (order == NULL) {
+        log_error(category_video, "unable to grow the sprite order to %d", SPRITE_MAX + grown);
+        return false;
+    }
+    s_spr_order = order;
+
+    vid_spr_span_t* spans = realloc(s_spr_spans, (SPRITE_MAX + grown) * sizeof(vid_spr_span_t));
+    if (spans == NULL) {
+        log_error(category_video, "unable to grow the sprite spans to %d", SPRITE_MAX + grown);
+        return false;
+    }
+    s_spr_spans = spans;
+
+    for (uint32_t c = s_spr_virtual_capacity / SPRITE_MAX; c < grown / SPRITE_MAX; c++) {
+        s_spr_chunks[c] = calloc(SPRITE_MAX, sizeof(spr_control_block_t));
+        if (s_spr_chunks[c] == NULL) {
+            log_error(category_video, "unable to grow the virtual sprites to %d", grown);
+            return false;
+        }
+        s_spr_virtual_capacity += SPRITE_MAX;
+    }
+    return true;
+}
+
+// virtual sprites in use in the chunk holding sprite first
+static uint32_t video_spr_chunk_count(uint32_t first) {
+    const uint32_t left = s_spr_virtual_count - first;
+    return left < SPRITE_MAX ? left : SPRITE_MAX;
+}
+
+// the span's scanlines that fall in cell row cy, as bits of span->rows
+static uint32_t video_spr_row_lines(const vid_spr_span_t* span, int32_t cy) {
+    const int32_t y0 = cy * TILE_HEIGHT > span->clip.y0 ? cy * TILE_HEIGHT : span->clip.y0;
+    const int32_t y1 = cy * TILE_HEIGHT + TILE_HEIGHT < span->clip.y1 ? cy * TILE_HEIGHT + TILE_HEIGHT : span->clip.y1;
+    return ((1u << (y1 - y0)) - 1) << (y0 - span->block->y);
+}
+
+// hands out the row slots when more than SPRITE_MAX spans share a row:
+// spans are admitted starting from s_spr_flicker, & lose the lines of
+// every row that is already full.
+static void video_spr_multiplex(uint32_t span_count) {
+    uint32_t admitted[TILE_MAP_HEIGHT] = {0};
+    uint32_t overflows = 0;
+    uint32_t flickered = 0;
+    uint32_t first = span_count;
+
+    const uint32_t start = s_spr_flicker < span_count ? s_spr_flicker : 0;
+    for (uint32_t n = 0; n < span_count; n++) {
+        const uint32_t index = (start + n) % span_count;
+        vid_spr_span_t* span = &s_spr_spans[index];
+
+        bool dropped = false;
+        for (int32_t cy = span->clip.y0 / TILE_HEIGHT; cy <= (span->clip.y1 - 1) / TILE_HEIGHT; cy++) {
+            const uint32_t lines = video_spr_row_lines(span, cy);
+            if ((span->rows & lines) == 0)
+                continue;
+            if (admitted[cy] < SPRITE_MAX) {
+                admitted[cy]++;
+                continue;
+            }
+            span->rows &= (uint16_t) ~lines;
+            overflows++;
+            dropped = true;
+        }
+
+        if (dropped) {
+            flickered++;
+            if (first == span_count)
+                first = index;
+        }
+    }
+
+    s_spr_flicker = first < span_count ? first : 0;
+    s_stats.sprite_overflows = overflows;
+    s_stats.sprite_flickered = flickered;
+    s_spr_flickered_total += flickered;
+    if (overflows > 0)
+        s_spr_overflow_frames++;
+}
+
+static void video_spr_bucket(void) {
+    blit_clip_t screen;
+    video_spr_clip(&screen);
+
+    uint32_t dropped = 0;
+    uint32_t span_count = 0;
+    uint32_t busiest = 0;
+    memset(s_spr_bucket_counts, 0, sizeof(s_spr_bucket_counts));
+    memset(s_spr_line_counts, 0, sizeof(s_spr_line_counts));
+
+    uint32_t count;
+    spr_control_block_t* const* order = video_sprite_sort(&count);
+    for (uint32_t n = 0; n < count; n++) {
+        spr_control_block_t* block = order[n];
+
+        video_fg_touch(block->x, block->y, SPRITE_WIDTH, SPRITE_HEIGHT);
+
+        if (block->tile >= SPRITE_MAX)
+            continue;
+        block->flags &= ~f_spr_changed;
+
+        vid_spr_span_t* span = &s_spr_spans[span_count];
+        span->clip.x0 = block->x > screen.x0 ? block->x : screen.x0;
+        span->clip.y0 = block->y > screen.y0 ? block->y : screen.y0;
+        span->clip.x1 = block->x + SPRITE_WIDTH < screen.x1 ? block->x + SPRITE_WIDTH : screen.x1;
+        span->clip.y1 = block->y + SPRITE_HEIGHT < screen.y1 ? block->y + SPRITE_HEIGHT : screen.y1;
+        if (span->clip.x0 >= span->clip.x1 || span->clip.y0 >= span->clip.y1)
+            continue;
+
+        span->block = block;
+        span->rows = 0;
+        for (int32_t y = span->clip.y0; y < span->clip.y1; y++) {
+            if (s_spr_line_limit != 0 && s_spr_line_counts[y] >= s_spr_line_limit) {
+                dropped++;
+                continue;
+            }
+            s_spr_line_counts[y]++;
+            span->rows |= (uint16_t) (1u << (y - block->y));
+        }
+        if (span->rows == 0)
+            continue;
+
+        for (int32_t cy = span->clip.y0 / TILE_HEIGHT; cy <= (span->clip.y1 - 1) / TILE_HEIGHT; cy++) {
+            if (++s_spr_bucket_counts[cy] > busiest)
+                busiest = s_spr_bucket_counts[cy];
+        }
+        span_count++;
+    }
+
+    s_stats.dropped_lines = dropped;
+    s_stats.sprite_overflows = 0;
+    s_stats.sprite_flickered = 0;
+    if (busiest > SPRITE_MAX)
+        video_spr_multiplex(span_count);
+
+    // buckets are filled in draw order, whichever spans got the slots
+    memset(s_spr_bucket_counts, 0, sizeof(s_spr_bucket_counts));
+    for (uint32_t i = 0; i < span_count; i++) {
+        const vid_spr_span_t* span = &s_spr_spans[i];
+        for (int32_t cy = span->clip.y0 / TILE_HEIGHT; cy <= (span->clip.y1 - 1) / TILE_HEIGHT; cy++) {
+            if ((span->rows & video_spr_row_lines(span, cy)) != 0)
+                s_spr_buckets[cy][s_spr_bucket_counts[cy]++] = i;
+        }
+    }
+}
+
+static uint8_t video_spr_blit_flags(uint8_t flags) {
+    uint8_t blit_flags = f_blit_none;
+    if ((flags & f_spr_hflip) == f_spr_hflip)
+        blit_flags |= f_blit_hflip;
+    if ((flags & f_spr_vflip) == f_spr_vflip)
+        blit_flags |= f_blit_vflip;
+    return blit_flags;
+}
+
+static uint8_t video_tile_cache_flags(uint8_t flags) {
+    uint8_t cache_flags = f_tile_cache_none;
+    if ((flags & f_bg_hflip) == f_bg_hflip)
+        cache_flags |= f_tile_cache_hflip;
+    if ((flags & f_bg_vflip) == f_bg_vflip)
+        cache_flags |= f_tile_cache_vflip;
+    return cache_flags;
+}
+
+static void video_fg_prepare(void) {
+    uint32_t restored = 0;
+
+    // cells drawn over last frame join this frame's restore set; the
+    // touched map is then rebuilt from this frame's sprites & commands.
+    for (uint32_t cy = 0; cy < TILE_MAP_HEIGHT; cy++) {
+        uint8_t* restore = &s_fg_restore[cy * TILE_MAP_WIDTH];
+        const uint8_t* touched = &s_fg_touched[cy * TILE_MAP_WIDTH];
+
+        uint32_t cells = 0;
+        for (uint32_t cx = 0; cx < TILE_MAP_WIDTH; cx++) {
+            restore[cx] |= touched[cx];
+            cells += restore[cx];
+        }
+
+        if (cells == 0)
+            continue;
+
+        restored += cells * TILE_SIZE * (s_indexed ? 1 : 4);
+        memset(&s_fg_rows[cy * TILE_HEIGHT], 1, TILE_HEIGHT);
+    }
+
+    memset(s_fg_touched, 0, sizeof(s_fg_touched));
+    s_stats.restored_bytes = restored;
+
+    video_spr_bucket();
+
+    if (s_indexed) {
+        for (uint32_t i = 0; i < TILE_MAP_SIZE; i++)
+            s_fg_expand[i] = s_fg_restore[i] | s_fg_touched[i];
+    }
+
+    if (s_index_colors_changed) {
+        memset(s_fg_rows, 1, sizeof(s_fg_rows));
+        memset(s_fg_expand, 1, sizeof(s_fg_expand));
+        s_index_colors_changed = false;
+    }
+
+    uint32_t offset = 0;
+    const cmd_header_t* cmd;
+    while ((cmd = cmd_stream_next(&s_pre_commands, &offset)) != NULL) {
+        switch (cmd->type) {
+            case vid_pre_spr: {
+                const vid_tile_data_t* tile = CMD_STREAM_PAYLOAD(cmd);
+                video_fg_touch(tile->x, tile->y, SPRITE_WIDTH, SPRITE_HEIGHT);
+                break;
+            }
+            case vid_pre_tile: {
+                const vid_tile_data_t* tile = CMD_STREAM_PAYLOAD(cmd);
+                video_fg_touch(tile->x, tile->y, TILE_WIDTH, TILE_HEIGHT);
+                if (s_band_count > 1)
+                    tile_cache_block(tile->tile, tile->palette, video_tile_cache_flags(tile->flags));
+                break;
+            }
+            case vid_pre_hline: {
+                const vid_hline_data_t* line = CMD_STREAM_PAYLOAD(cmd);
+                video_fg_touch(line->x, line->y, line->w, 1);
+                break;
+            }
+            case vid_pre_vline: {
+                const vid_vline_data_t* line = CMD_STREAM_PAYLOAD(cmd);
+                video_fg_touch(line->x, line->y, 1, line->h);
+                break;
+            }
+            case vid_pre_rect: {
+                const vid_rect_data_t* vid_rect = CMD_STREAM_PAYLOAD(cmd);
+                const rect_t* bounds = &vid_rect->bounds;
+                if (vid_rect->fill)
+                    video_fg_touch(bounds->left, bounds->top, bounds->width, bounds->height);
+                else
+                    video_fg_touch(bounds->left, bounds->top, bounds->width + 1, bounds->height + 1);
+                break;
+            }
+            default: {
+                break;
+            }
+        }
+    }
+}
+
+static void video_bg_source(
+        const bg_control_block_t* block,
+        uint16_t* tile_index,
+        uint8_t* palette_index) {
+    *tile_index = block->tile;
+    *palette_index = block->palette;
+    if ((block->flags & f_bg_enabled) == 0) {
+        *tile_index = 0x0a;
+        *palette_index = 0x0f;
+    }
+}
+
+static uint32_t video_wrap(int32_t value, uint32_t size) {
+    const int32_t m = value % (int32_t) size;
+    return (uint32_t) (m < 0 ? m + (int32_t) size : m);
+}
+
+static int32_t video_floor_div(int32_t value, int32_t size) {
+    return value >= 0 ? value / size : -((size - 1 - value) / size);
+}
+
+// the playfield entry whose pixel the bg ring holds at (px, py)
+static const tile_map_entry_t* video_playfield_entry(uint32_t px, uint32_t py) {
+    const int32_t x = s_scroll_x + (int32_t) ((px - (uint32_t) s_scroll_x) & (SCREEN_WIDTH - 1));
+    const int32_t y = s_scroll_y + (int32_t) ((py - (uint32_t) s_scroll_y) & (SCREEN_HEIGHT - 1));
+    const uint32_t col = video_wrap(video_floor_div(x, TILE_WIDTH), s_playfield_cols);
+    const uint32_t row = video_wrap(video_floor_div(y, TILE_HEIGHT), s_playfield_rows);
+    return &s_playfield[row * s_playfield_cols + col];
+}
+
+// composites one fg line from the bg under its raster effect: shifted by
+// the line's scroll, and re-rendered from the tile sources when the line
+// overrides the palette.
+static void video_raster_compose(uint8_t* dst, uint32_t y, uint32_t left, uint32_t width) {
+    const vid_raster_t* line = &s_raster[y];
+    const uint32_t bpp = s_indexed ? 1 : 4;
+    const uint32_t by = (y + (uint32_t) s_scroll_y) & (SCREEN_HEIGHT - 1);
+    uint32_t bx = (left + (uint32_t) s_scroll_x + (uint32_t) line->scroll_x) & (SCREEN_WIDTH - 1);
+    const uint8_t* row = s_indexed ?
+        &s_bg_indexes[by * SCREEN_WIDTH] :
+        (const uint8_t*) s_bg_surface->pixels + by * s_bg_surface->pitch;
+
+    if (line->palette < 0 || palette((uint8_t) line->palette) == NULL) {
+        const uint32_t first = bx + width <= SCREEN_WIDTH ? width : SCREEN_WIDTH - bx;
+        memcpy(dst, row + bx * bpp, first * bpp);
+        if (first < width)
+            memcpy(dst + first * bpp, row, (width - first) * bpp);
+        return;
+    }
+
+    const uint8_t pal_index = (uint8_t) line->palette;
+    const uint32_t ly = by % TILE_HEIGHT;
+    const uint32_t seam = (uint32_t) s_scroll_x & (SCREEN_WIDTH - 1);
+    uint32_t x = 0;
+    while (x < width) {
+        const uint32_t lx = bx % TILE_WIDTH;
+        uint32_t count = TILE_WIDTH - lx < width - x ? TILE_WIDTH - lx : width - x;
+        if (s_playfield != NULL && bx < seam && bx + count > seam)
+            count = seam - bx;
+
+        uint16_t tile_index;
+        uint8_t flags;
+        if (s_playfield != NULL) {
+            const tile_map_entry_t* entry = video_playfield_entry(bx, by);
+            tile_index = entry->tile;
+            flags = entry->flags;
+        } else {
+            const bg_control_block_t* block = &s_bg_control[by / TILE_HEIGHT * TILE_MAP_WIDTH + bx / TILE_WIDTH];
+            uint8_t unused;
+            video_bg_source(block, &tile_index, &unused);
+            flags = block->flags;
+        }
+
+        const uint8_t cache_flags = video_tile_cache_flags(flags);
+        uint8_t* out = dst + x * bpp;
+        if (s_indexed && tile_index < TILE_MAX) {
+            const uint8_t* src = &s_tile_indexes[tile_index][cache_flags][ly * TILE_WIDTH + lx];
+            for (uint32_t i = 0; i < count; i++)
+                out[i] = (uint8_t) (src[i] | (pal_index << 2));
+        } else {
+            uint32_t scratch[TILE_SIZE];
+            const uint32_t* block = NULL;
+            if (!s_indexed) {
+                block = s_band_count > 1 ?
+                    tile_cache_peek(tile_index, pal_index, cache_flags, scratch) :
+                    tile_cache_block(tile_index, pal_index, cache_flags);
+            }
+            if (block != NULL)
+                memcpy(out, block + ly * TILE_WIDTH + lx, count * 4);
+            else
+                memcpy(out, row + bx * bpp, count * bpp);
+        }
+
+        x += count;
+        bx = (bx + count) & (SCREEN_WIDTH - 1);
+    }
+}
+
+static void video_fg_restore(const vid_band_t* band) {
+    const uint32_t bpp = s_indexed ? 1 : 4;
+    const uint32_t src_pitch = s_indexed ? SCREEN_WIDTH : (uint32_t) s_bg_surface->pitch;
+    const uint32_t dst_pitch = s_indexed ? SCREEN_WIDTH : (uint32_t) s_fg_target.pitch;
+    const uint8_t* bg = s_indexed ? s_bg_indexes : (const uint8_t*) s_bg_surface->pixels;
+    uint8_t* fg = s_indexed ? s_fg_indexes : s_fg_target.pixels;
+    const uint32_t ox = (uint32_t) s_scroll_x & (SCREEN_WIDTH - 1);
+    const uint32_t oy = (uint32_t) s_scroll_y & (SCREEN_HEIGHT - 1);
+
+    for (uint32_t cy = band->top / TILE_HEIGHT; cy < band->bottom / TILE_HEIGHT; cy++) {
+        uint8_t* restore = &s_fg_restore[cy * TILE_MAP_WIDTH];
+
+        uint32_t cx = 0;
+        while (cx < TILE_MAP_WIDTH) {
+            if (restore[cx] == 0) {
+                cx++;
+                continue;
+            }
+
+            const uint32_t start = cx;
+            while (cx < TILE_MAP_WIDTH && restore[cx] != 0)
+                cx++;
+
+            // the run wraps around the bg ring at most once horizontally
+            const uint32_t top = cy * TILE_HEIGHT;
+            const uint32_t left = start * TILE_WIDTH;
+            const uint32_t width = (cx - start) * TILE_WIDTH;
+            const uint32_t bg_left = (left + ox) & (SCREEN_WIDTH - 1);
+            const uint32_t first = bg_left + width <= SCREEN_WIDTH ? width : SCREEN_WIDTH - bg_left;
+            const uint8_t lines = s_raster_lines[cy];
+            uint8_t* dst = fg + top * dst_pitch + left * bpp;
+            for (uint32_t y = 0; y < TILE_HEIGHT; y++) {
+                if ((lines & (1u << y)) != 0) {
+                    video_raster_compose(dst, top + y, left, width);
+                    dst += dst_pitch;
+                    continue;
+                }
+
+                const uint8_t* src = bg + ((top + y + oy) & (SCREEN_HEIGHT - 1)) * src_pitch;
+                memcpy(dst, src + bg_left * bpp, first * bpp);
+                if (first < width)
+                    memcpy(dst + first * bpp, src, (width - first) * bpp);
+                dst += dst_pitch;
+            }
+        }
+
+        memset(restore, 0, TILE_MAP_WIDTH);
+    }
+}
+
+static void video_fg_upload(video_sink_t* sink) {
+    uint32_t uploaded = 0;
+
+    uint32_t y = 0;
+    while (y < SCREEN_HEIGHT) {
+        if (s_fg_rows[y] == 0) {
+            y++;
+            continue;
+        }
+
+        const uint32_t start = y;
+        while (y < SCREEN_HEIGHT && s_fg_rows[y] != 0)
+            y++;
+
+        video_band_t band = {
+            .pixels = (const uint8_t*) s_fg_surface->pixels + start * s_fg_surface->pitch,
+            .pitch = s_fg_surface->pitch,
+            .top = (uint16_t) start,
+            .height = (uint16_t) (y - start)
+        };
+        sink->upload(sink, &band);
+        uploaded += (y - start) * SCREEN_WIDTH * 4;
+    }
+
+    memset(s_fg_rows, 0, sizeof(s_fg_rows));
+    s_stats.uploaded_bytes = uploaded;
+}
+
+static void video_fg_invalidate(void) {
+    memset(s_fg_restore, 1, sizeof(s_fg_restore));
+    memset(s_fg_expand, 1, sizeof(s_fg_expand));
+    memset(s_fg_rows, 1, sizeof(s_fg_rows));
+}
+
+static bool video_fg_lock(video_sink_t* sink) {
+    if (!s_zero_copy || sink->lock == NULL)
+        return false;
+
+    uint32_t first = 0;
+    while (first < SCREEN_HEIGHT && s_fg_rows[first] == 0)
+        first++;
+    if (first == SCREEN_HEIGHT)
+        return false;
+
+    uint32_t last = SCREEN_HEIGHT;
+    while (s_fg_rows[last - 1] == 0)
+        last--;
+
+    first = first / TILE_HEIGHT * TILE_HEIGHT;
+    last = (last + TILE_HEIGHT - 1) / TILE_HEIGHT * TILE_HEIGHT;
+
+    int32_t pitch;
+    uint8_t* pixels = sink->lock(sink, (uint16_t) first, (uint16_t) (last - first), &pitch);
+    if (pixels == NULL) {
+        log_warn(category_video, "sink cannot lock its texture; falling back to uploads.");
+        s_zero_copy = false;
+        video_fg_invalidate();
+        return false;
+    }
+
+    // the locked rows come back undefined, so every cell in them is
+    // recomposed: restored from the bg, or expanded from the index buffer.
+    const uint32_t cells = (last - first) / TILE_HEIGHT * TILE_MAP_WIDTH;
+    uint8_t* recompose = s_indexed ? s_fg_expand : s_fg_restore;
+    memset(&recompose[first / TILE_HEIGHT * TILE_MAP_WIDTH], 1, cells);
+    if (!s_indexed)
+        s_stats.restored_bytes = cells * TILE_SIZE * 4;
+
+    // the draw paths address whole-screen rows; offset the base so row
+    // `first` lands on the start of the locked rect.
+    s_fg_target.pixels = pixels - (intptr_t) first * pitch;
+    s_fg_target.pitch = pitch;
+
+    memset(s_fg_rows, 0, sizeof(s_fg_rows));
+    s_stats.uploaded_bytes = (last - first) * SCREEN_WIDTH * 4;
+    return true;
+}
+
+static void video_stats_update(void) {
+    s_stats.merged_fills = s_merged_fills;
+    s_merged_fills = 0;
+    s_stats.command_bytes = s_pre_commands.high_water + s_post_commands.high_water;
+    s_stats.command_overflows = s_pre_commands.overflows + s_post_commands.overflows;
+    cmd_stream_reset_stats(&s_pre_commands);
+    cmd_stream_reset_stats(&s_post_commands);
+    if (s_stats.command_bytes > s_command_peak)
+        s_command_peak = s_stats.command_bytes;
+    s_command_dropped += s_stats.command_overflows;
+    s_stats.frames++;
+    s_stats.restored_total += s_stats.restored_bytes;
+    s_stats.uploaded_total += s_stats.uploaded_bytes;
+    if (s_stats.frames % FRAME_RATE != 0)
+        return;
+
+    log_message(
+        category_video,
+        "per frame: uploaded %d bytes, restored %d bytes.",
+        s_stats.uploaded_total / FRAME_RATE,
+        s_stats.restored_total / FRAME_RATE);
+    s_stats.restored_total = 0;
+    s_stats.uploaded_total = 0;
+
+    if (s_spr_overflow_frames > 0) {
+        log_message(
+            category_video,
+            "sprite bands: %d of %d frames overflowed, %d sprites flickered per frame.",
+            s_spr_overflow_frames,
+            FRAME_RATE,
+            s_spr_flickered_total / FRAME_RATE);
+        s_spr_overflow_frames = 0;
+        s_spr_flickered_total = 0;
+    }
+
+    if (s_command_peak > 0) {
+        log_message(
+            category_video,
+            "command streams: %d bytes high-water, %d commands dropped.",
+            s_command_peak,
+            s_command_dropped);
+        s_command_peak = 0;
+        s_command_dropped = 0;
+    }
+
+    if (s_stats.bg_cache_hits + s_stats.bg_cache_misses > 0) {
+        log_message(
+            category_video,
+            "bg cache: %d hits, %d misses; last set redrew %d cells.",
+            s_stats.bg_cache_hits,
+            s_stats.bg_cache_misses,
+            s_stats.bg_set_cells);
+    }
+
+    const text_cache_stats_t* text_stats = text_cache_stats();
+    if (text_stats->hits + text_stats->misses > 0) {
+        log_message(
+            category_video,
+            "text cache: %d hits, %d misses, %d evictions.",
+            text_stats->hits,
+            text_stats->misses,
+            text_stats->evictions);
     }
 }
 
 static bool video_draw_spr(
-        SDL_Surface* surface,
+        const blit_target_t* target,
+        const vid_band_t* band,
         uint16_t px,
         uint16_t py,
         uint16_t tile_index,
         uint8_t pal_index,
         uint8_t flags) {
-    const palette_t* pal = palette(pal_index);
-    if (pal == NULL)
-        return false;
+    blit_clip_t clip;
+    video_spr_clip(&clip);
+    if (clip.y0 < band->top)
+        clip.y0 = band->top;
+    if (clip.y1 > band->bottom)
+        clip.y1 = band->bottom;
+
+    const uint8_t blit_flags = video_spr_blit_flags(flags);
+    return blit_sprite(target, &clip, px, py, tile_index, pal_index, blit_flags);
+}
 
-    const sprite_bitmap_t* bitmap = sprite_bitmap(tile_index);
-    if (bitmap == NULL)
+static bool video_draw_tile(
+        const blit_target_t* target,
+        const vid_band_t* band,
+        uint16_t tx,
+        uint16_t ty,
+        uint16_t tile_index,
+        uint8_t pal_index,
+        uint8_t flags) {
+    const uint8_t cache_flags = video_tile_cache_flags(flags);
+
+    // workers only read the cache; video_update warms it before the bands run.
+    uint32_t scratch[TILE_SIZE];
+    const uint32_t* block = s_band_count > 1 ?
+        tile_cache_peek(tile_index, pal_index, cache_flags, scratch) :
+        tile_cache_block(tile_index, pal_index, cache_flags);
+    if (block == NULL)
         return false;
 
-    const bool horizontal_flip = (flags & f_spr_hflip) == f_spr_hflip;
-    const bool vertical_flip = (flags & f_spr_vflip) == f_spr_vflip;
-
-    uint8_t sy = (uint8_t) (vertical_flip ? SPRITE_HEIGHT - 1 : 0);
-    int8_t syd = (int8_t) (vertical_flip ? -1 : 1);
-    int8_t sxd = (int8_t) (horizontal_flip ? -1 : 1);
-
-    for (uint32_t y = 0; y < SPRITE_HEIGHT; y++) {
-        uint32_t ty = py + y;
-        if (ty > s_clip_rect.top
-        &&  ty < s_clip_rect.top + s_clip_rect.height) {
-            uint8_t* p = surface->pixels + (ty * surface->pitch + (px * 4));
-            uint8_t sx = (uint8_t) (horizontal_flip ? SPRITE_WIDTH - 1 : 0);
-            for (uint32_t x = 0; x < SPRITE_WIDTH; x++) {
-                uint32_t tx = px + x;
-                if (tx < s_clip_rect.left || tx > s_clip_rect.left + s_clip_rect.width) {
-                    p += 4;
-                } else {
-                    const uint32_t pixel_offset = (const uint32_t) (sy * SPRITE_WIDTH + sx);
-                    const palette_entry_t* pal_entry = &pal->entries[bitmap->data[pixel_offset]];
-                    if (pal_entry->alpha == 0x00)
-                        p += 4;
-                    else {
-                        *p++ = pal_entry->red;
-                        *p++ = pal_entry->green;
-                        *p++ = pal_entry->blue;
-                        *p++ = pal_entry->alpha;
-                    }
-                }
-                sx += sxd;
-            }
+    uint32_t y0 = ty;
+    uint32_t y1 = ty + TILE_HEIGHT;
+    if (y0 < band->top)
+        y0 = band->top;
+    if (y1 > band->bottom)
+        y1 = band->bottom;
+
+    uint8_t* p = target->pixels + (y0 * target->pitch + (tx * 4));
+    if (y0 == ty && y1 == ty + TILE_HEIGHT) {
+        // the common case: flips are baked into the cached block, so an
+        // unclipped tile is a fixed run of row copies.
+        for (uint32_t y = 0; y < TILE_HEIGHT; y++) {
+            memcpy(p, block + y * TILE_WIDTH, TILE_WIDTH * 4);
+            p += target->pitch;
         }
-        sy += syd;
+        return true;
+    }
+
+    for (uint32_t y = y0; y < y1; y++) {
+        memcpy(p, block + (y - ty) * TILE_WIDTH, TILE_WIDTH * 4);
+        p += target->pitch;
     }
 
     return true;
 }
 
-static bool video_draw_tile(
-        SDL_Surface* surface,
+static bool video_draw_tile_indexed(
+        const vid_band_t* band,
         uint16_t tx,
         uint16_t ty,
         uint16_t tile_index,
         uint8_t pal_index,
         uint8_t flags) {
-    const palette_t* pal = palette(pal_index);
-    if (pal == NULL)
+    if (tile_index >= TILE_MAX || palette(pal_index) == NULL)
         return false;
 
-    const tile_bitmap_t* bitmap = tile_bitmap(tile_index);
-    if (bitmap == NULL)
-        return false;
+    uint32_t y0 = ty;
+    uint32_t y1 = ty + TILE_HEIGHT;
+    if (y0 < band->top)
+        y0 = band->top;
+    if (y1 > band->bottom)
+        y1 = band->bottom;
+
+    const uint64_t high = (uint64_t) (uint8_t) (pal_index << 2) * 0x0101010101010101ull;
+    const uint8_t* src = s_tile_indexes[tile_index][video_tile_cache_flags(flags)];
+
+    uint8_t* p = &s_bg_indexes[y0 * SCREEN_WIDTH + tx];
+    for (uint32_t y = y0; y < y1; y++) {
+        uint64_t row;
+        memcpy(&row, src + (y - ty) * TILE_WIDTH, TILE_WIDTH);
+        row |= high;
+        memcpy(p, &row, TILE_WIDTH);
+        p += SCREEN_WIDTH;
+    }
 
-    const bool vertical_flip = (flags & f_bg_vflip) == f_bg_vflip;
-    const bool horizontal_flip = (flags & f_bg_hflip) == f_bg_hflip;
+    return true;
+}
 
-    uint8_t sy = (uint8_t) (vertical_flip ? TILE_HEIGHT - 1 : 0);
-    int8_t syd = (int8_t) (vertical_flip ? -1 : 1);
-    int8_t sxd = (int8_t) (horizontal_flip ? -1 : 1);
+static void video_tile_indexes(uint16_t tile_index) {
+    const tile_bitmap_t* bitmap = tile_bitmap(tile_index);
+    if (bitmap == NULL)
+        return;
 
-    for (uint32_t y = 0; y < TILE_HEIGHT; y++) {
-        uint8_t* p = surface->pixels + ((ty + y) * surface->pitch + (tx * 4));
-        uint8_t sx = (uint8_t) (horizontal_flip ? TILE_WIDTH - 1 : 0);
-        for (uint32_t x = 0; x < TILE_WIDTH; x++) {
-            const uint32_t pixel_offset = (const uint32_t) (sy * TILE_WIDTH + sx);
-            const palette_entry_t* pal_entry = &pal->entries[bitmap->data[pixel_offset]];
-            *p++ = pal_entry->red;
-            *p++ = pal_entry->green;
-            *p++ = pal_entry->blue;
-            *p++ = 0xff;
-            sx += sxd;
+    for (uint32_t f = 0; f < 4; f++) {
+        uint8_t* p = s_tile_indexes[tile_index][f];
+        for (uint32_t y = 0; y < TILE_HEIGHT; y++) {
+            const uint32_t sy = (f & f_tile_cache_vflip) != 0 ? TILE_HEIGHT - 1 - y : y;
+            for (uint32_t x = 0; x < TILE_WIDTH; x++) {
+                const uint32_t sx = (f & f_tile_cache_hflip) != 0 ? TILE_WIDTH - 1 - x : x;
+                *p++ = (uint8_t) (bitmap->data[sy * TILE_WIDTH + sx] & 0x03);
+            }
         }
-        sy += syd;
     }
-
-    return true;
 }
 
 static void video_bg_update(uint32_t ticks) {
@@ -231,166 +1035,528 @@ static void video_bg_update(uint32_t ticks) {
                 blinker->timeout = ticks + blinker->duration;
             }
 
-            int32_t ty1 = blinker->bounds.top;
-            int32_t tx1 = blinker->bounds.left;
-            for (uint8_t y = 0; y < blinker->bounds.height; y++) {
-                for (uint8_t x = 0; x < blinker->bounds.width; x++) {
-                    bg_control_block_t* block1 = video_tile(
-                        (uint8_t) ty1,
-                        (uint8_t) tx1);
+            const rect_t* bounds = &blinker->bounds;
+            const int32_t bottom = bounds->top + bounds->height;
+            const int32_t right = bounds->left + bounds->width;
+            for (int32_t y = bounds->top; y < bottom && y < TILE_MAP_HEIGHT; y++) {
+                for (int32_t x = bounds->left; x < right && x < TILE_MAP_WIDTH; x++) {
+                    bg_control_block_t* block = &s_bg_control[y * TILE_MAP_WIDTH + x];
                     if (!blinker->visible) {
-                        block1->flags &= ~f_bg_enabled;
+                        block->flags &= ~f_bg_enabled;
                     } else {
-                        block1->flags |= f_bg_enabled;
+                        block->flags |= f_bg_enabled;
                     }
-                    block1->flags |= f_bg_changed;
-
-                    if (tx1 < TILE_MAP_WIDTH)
-                        tx1++;
                 }
-                tx1 = blinker->bounds.left;
-                if (ty1 < TILE_MAP_HEIGHT)
-                    ty1++;
             }
+            video_bg_mark_rect(*bounds);
 
             blinker->visible = !blinker->visible;
         }
     }
 
-    uint32_t tx = 0;
-    uint32_t ty = 0;
-    SDL_LockSurface(s_bg_surface);
+    // s_bg_control edits wait in the dirty bits until the playfield detaches
+    if (s_playfield != NULL && s_renderer_type == video_renderer_cpu)
+        return;
+
+    for (uint32_t cy = 0; cy < TILE_MAP_HEIGHT; cy++) {
+        uint32_t bits = s_bg_dirty[cy];
+        if (bits == 0)
+            continue;
+        s_bg_dirty[cy] = 0;
+
+        while (bits != 0) {
+            const uint32_t i = cy * TILE_MAP_WIDTH + video_bg_ctz(bits);
+            bits &= bits - 1;
+
+            s_bg_redraw[i] = 1;
+            video_fg_restore_cell(i);
+
+            if (s_band_count > 1 && !s_indexed) {
+                const bg_control_block_t* block = &s_bg_control[i];
+                uint16_t tile_index;
+                uint8_t palette_index;
+                video_bg_source(block, &tile_index, &palette_index);
+                tile_cache_block(tile_index, palette_index, video_tile_cache_flags(block->flags));
+            }
+        }
+    }
+}
+
+static void video_bg_draw(const vid_band_t* band) {
+    const blit_target_t target = {
+        .pixels = s_bg_surface->pixels,
+        .pitch = s_bg_surface->pitch
+    };
+    const uint32_t first = band->top / TILE_HEIGHT * TILE_MAP_WIDTH;
+    const uint32_t last = band->bottom / TILE_HEIGHT * TILE_MAP_WIDTH;
+
+    for (uint32_t i = first; i < last; i++) {
+        if (s_bg_redraw[i] == 0)
+            continue;
+        s_bg_redraw[i] = 0;
 
-    for (uint32_t i = 0; i < TILE_MAP_SIZE; i++) {
         bg_control_block_t* block = &s_bg_control[i];
 
-        uint16_t tile_index = block->tile;
-        uint8_t palette_index = block->palette;
+        uint16_t tile_index;
+        uint8_t palette_index;
+        video_bg_source(block, &tile_index, &palette_index);
+
+        const uint16_t tx = (uint16_t) ((i % TILE_MAP_WIDTH) * TILE_WIDTH);
+        const uint16_t ty = (uint16_t) ((i / TILE_MAP_WIDTH) * TILE_HEIGHT);
+        const bool drawn = s_indexed ?
+            video_draw_tile_indexed(band, tx, ty, tile_index, palette_index, block->flags) :
+            video_draw_tile(&target, band, tx, ty, tile_index, palette_index, block->flags);
+        if (!drawn)
+            video_bg_dirty(i);
+    }
+}
 
-        if ((block->flags & f_bg_changed) == 0)
-            goto next_tile;
+// redraws one 8x8 slot of the bg ring. the ring is exactly one screen,
+// so the slot at the scroll seam shows the left part of one playfield
+// cell and the right part of another; cells are 8-aligned on both sides,
+// so each row splits at most once.
+static bool video_ring_draw(uint32_t cx, uint32_t cy) {
+    const uint32_t left = cx * TILE_WIDTH;
+    const uint32_t seam = (uint32_t) s_scroll_x & (SCREEN_WIDTH - 1);
+    const uint32_t split = seam > left && seam < left + TILE_WIDTH ? seam - left : TILE_WIDTH;
+
+    for (uint32_t ly = 0; ly < TILE_HEIGHT; ly++) {
+        const uint32_t py = cy * TILE_HEIGHT + ly;
+        for (uint32_t lx = 0; lx < TILE_WIDTH; lx = split > lx ? split : TILE_WIDTH) {
+            const uint32_t count = (split > lx ? split : TILE_WIDTH) - lx;
+            const tile_map_entry_t* entry = video_playfield_entry(left + lx, py);
+            const uint8_t cache_flags = video_tile_cache_flags(entry->flags);
+
+            if (s_indexed) {
+                if (entry->tile >= TILE_MAX || palette(entry->palette) == NULL)
+                    return false;
+                const uint8_t high = (uint8_t) (entry->palette << 2);
+                const uint8_t* src = &s_tile_indexes[entry->tile][cache_flags][ly * TILE_WIDTH + lx];
+                uint8_t* dst = &s_bg_indexes[py * SCREEN_WIDTH + left + lx];
+                for (uint32_t x = 0; x < count; x++)
+                    dst[x] = src[x] | high;
+            } else {
+                const uint32_t* block = tile_cache_block(entry->tile, entry->palette, cache_flags);
+                if (block == NULL)
+                    return false;
+                uint8_t* dst = (uint8_t*) s_bg_surface->pixels + py * s_bg_surface->pitch + (left + lx) * 4;
+                memcpy(dst, block + ly * TILE_WIDTH + lx, count * 4);
+            }
+        }
+    }
+    return true;
+}
 
-        if ((block->flags & f_bg_enabled) == 0) {
-            tile_index = 0x0a;
-            palette_index = 0x0f;
+static void video_ring_update(void) {
+    for (uint32_t cy = 0; cy < TILE_MAP_HEIGHT; cy++) {
+        uint32_t bits = s_ring_dirty[cy];
+        while (bits != 0) {
+            const uint32_t cx = video_bg_ctz(bits);
+            bits &= bits - 1;
+            if (!video_ring_draw(cx, cy))
+                continue;
+            s_ring_dirty[cy] &= ~(1u << cx);
+            video_fg_restore_cell(cy * TILE_MAP_WIDTH + cx);
         }
+    }
+}
 
-        if (video_draw_tile(
-                s_bg_surface,
-                tx,
-                ty,
-                tile_index,
-                palette_index,
-                block->flags)) {
-            block->flags &= ~f_bg_changed;
+// marks the ring columns (or rows) that show pixels [from, to) on an axis
+static void video_ring_expose(int32_t from, int32_t to, bool columns) {
+    if (to - from >= SCREEN_WIDTH) {
+        memset(s_ring_dirty, 0xff, sizeof(s_ring_dirty));
+        return;
+    }
+
+    uint32_t bits = 0;
+    for (int32_t p = video_floor_div(from, TILE_WIDTH); p <= video_floor_div(to - 1, TILE_WIDTH); p++)
+        bits |= 1u << video_wrap(p, TILE_MAP_WIDTH);
+
+    if (columns) {
+        for (uint32_t cy = 0; cy < TILE_MAP_HEIGHT; cy++)
+            s_ring_dirty[cy] |= bits;
+        return;
+    }
+    for (uint32_t cy = 0; cy < TILE_MAP_HEIGHT; cy++) {
+        if ((bits & (1u << cy)) != 0)
+            s_ring_dirty[cy] = 0xffffffffu;
+    }
+}
+
+static void video_spr_blit(
+        const blit_target_t* target,
+        const blit_clip_t* clip,
+        const spr_control_block_t* block,
+        uint8_t blit_flags) {
+    if (s_indexed) {
+        blit_sprite_indexed(
+            target,
+            clip,
+            block->x,
+            block->y,
+            block->tile,
+            block->palette,
+            blit_flags);
+    } else {
+        blit_sprite(
+            target,
+            clip,
+            block->x,
+            block->y,
+            block->tile,
+            block->palette,
+            blit_flags);
+    }
+}
+
+// color index of the bg pixel shown at screen (x, y), after scroll and
+// the line's raster shift; 0 is the bg's transparent color.
+static uint8_t video_bg_pixel(uint32_t x, uint32_t y) {
+    uint32_t bx = x + (uint32_t) s_scroll_x;
+    if ((s_raster_lines[y / TILE_HEIGHT] & (1u << (y % TILE_HEIGHT))) != 0)
+        bx += (uint32_t) s_raster[y].scroll_x;
+    bx &= SCREEN_WIDTH - 1;
+    const uint32_t by = (y + (uint32_t) s_scroll_y) & (SCREEN_HEIGHT - 1);
+
+    uint16_t tile_index;
+    uint8_t flags;
+    if (s_playfield != NULL) {
+        const tile_map_entry_t* entry = video_playfield_entry(bx, by);
+        tile_index = entry->tile;
+        flags = entry->flags;
+    } else {
+        const bg_control_block_t* block = &s_bg_control[by / TILE_HEIGHT * TILE_MAP_WIDTH + bx / TILE_WIDTH];
+        uint8_t unused;
+        video_bg_source(block, &tile_index, &unused);
+        flags = block->flags;
+    }
+
+    if (tile_index >= TILE_MAX)
+        return 0;
+    const uint8_t* src = s_tile_indexes[tile_index][video_tile_cache_flags(flags)];
+    return src[(by % TILE_HEIGHT) * TILE_WIDTH + bx % TILE_WIDTH];
+}
+
+// a sprite behind the bg only shows through the bg's transparent pixels;
+// it is blitted one run of such pixels at a time.
+static void video_spr_behind(
+        const blit_target_t* target,
+        const blit_clip_t* clip,
+        const spr_control_block_t* block,
+        uint8_t blit_flags) {
+    for (int32_t y = clip->y0; y < clip->y1; y++) {
+        int32_t x = clip->x0;
+        while (x < clip->x1) {
+            if (video_bg_pixel((uint32_t) x, (uint32_t) y) != 0) {
+                x++;
+                continue;
+            }
+
+            blit_clip_t run = {.x0 = x, .y0 = y, .x1 = x, .y1 = y + 1};
+            while (x < clip->x1 && video_bg_pixel((uint32_t) x, (uint32_t) y) == 0)
+                x++;
+            run.x1 = x;
+            video_spr_blit(target, &run, block, blit_flags);
+        }
+    }
+}
+
+static void video_fg_update(const vid_band_t* band) {
+    blit_target_t target = {
+        .pixels = s_indexed ? s_fg_indexes : s_fg_target.pixels,
+        .pitch = s_indexed ? SCREEN_WIDTH : s_fg_target.pitch
+    };
+
+    for (uint32_t cy = band->top / TILE_HEIGHT; cy < band->bottom / TILE_HEIGHT; cy++) {
+        const int32_t row_top = (int32_t) (cy * TILE_HEIGHT);
+        const uint32_t* bucket = s_spr_buckets[cy];
+
+        for (uint32_t i = 0; i < s_spr_bucket_counts[cy]; i++) {
+            const vid_spr_span_t* span = &s_spr_spans[bucket[i]];
+            const spr_control_block_t* block = span->block;
+
+            const uint8_t blit_flags = video_spr_blit_flags(block->flags);
+
+            int32_t y = span->clip.y0 > row_top ? span->clip.y0 : row_top;
+            const int32_t y1 = span->clip.y1 < row_top + TILE_HEIGHT ?
+                span->clip.y1 : row_top + TILE_HEIGHT;
+
+            // one blit per run of scanlines the line limit left visible
+            while (y < y1) {
+                if ((span->rows & (1u << (y - block->y))) == 0) {
+                    y++;
+                    continue;
+                }
+
+                blit_clip_t clip = span->clip;
+                clip.y0 = y;
+                while (y < y1 && (span->rows & (1u << (y - block->y))) != 0)
+                    y++;
+                clip.y1 = y;
+
+                if (block->priority == SPR_PRIORITY_BEHIND_BG)
+                    video_spr_behind(&target, &clip, block, blit_flags);
+                else
+                    video_spr_blit(&target, &clip, block, blit_flags);
+            }
+        }
+    }
+}
+
+static void video_fg_expand(const vid_band_t* band) {
+    const uint32_t pitch = (uint32_t) s_fg_target.pitch;
+
+    for (uint32_t cy = band->top / TILE_HEIGHT; cy < band->bottom / TILE_HEIGHT; cy++) {
+        uint8_t* expand = &s_fg_expand[cy * TILE_MAP_WIDTH];
+
+        uint32_t cx = 0;
+        while (cx < TILE_MAP_WIDTH) {
+            if (expand[cx] == 0) {
+                cx++;
+                continue;
+            }
+
+            const uint32_t start = cx;
+            while (cx < TILE_MAP_WIDTH && expand[cx] != 0)
+                cx++;
+
+            const uint32_t top = cy * TILE_HEIGHT;
+            const uint8_t* src = &s_fg_indexes[top * SCREEN_WIDTH + start * TILE_WIDTH];
+            uint8_t* dst = s_fg_target.pixels + top * pitch + start * TILE_WIDTH * 4;
+            for (uint32_t y = 0; y < TILE_HEIGHT; y++) {
+                blit_expand((uint32_t*) dst, src, s_index_colors, (cx - start) * TILE_WIDTH);
+                src += SCREEN_WIDTH;
+                dst += pitch;
+            }
+        }
+
+        memset(expand, 0, TILE_MAP_WIDTH);
+    }
+}
+
+static void video_fill(
+        const vid_band_t* band,
+        int32_t x,
+        int32_t y,
+        int32_t w,
+        int32_t h,
+        const color_t* color) {
+    const blit_clip_t clip = {
+        .x0 = 0,
+        .y0 = band->top,
+        .x1 = SCREEN_WIDTH,
+        .y1 = band->bottom
+    };
+
+    // colors hold red & blue exchanged, the same as the palettes
+    const uint32_t value = pixel_format_map(color->b, color->g, color->r, color->a);
+    blit_fill(&s_fg_target, &clip, x, y, w, h, value);
+}
+
+static void video_pre_commands(const vid_band_t* band) {
+    uint32_t offset = 0;
+    const cmd_header_t* cmd;
+    while ((cmd = cmd_stream_next(&s_pre_commands, &offset)) != NULL) {
+        switch (cmd->type) {
+            case vid_pre_spr: {
+                const vid_tile_data_t* tile = CMD_STREAM_PAYLOAD(cmd);
+                video_draw_spr(
+                    &s_fg_target,
+                    band,
+                    tile->x,
+                    tile->y,
+                    tile->tile,
+                    tile->palette,
+                    tile->flags);
+                break;
+            }
+            case vid_pre_tile: {
+                const vid_tile_data_t* tile = CMD_STREAM_PAYLOAD(cmd);
+                video_draw_tile(
+                    &s_fg_target,
+                    band,
+                    tile->x,
+                    tile->y,
+                    tile->tile,
+                    tile->palette,
+                    tile->flags);
+                break;
+            }
+            case vid_pre_hline: {
+                const vid_hline_data_t* line = CMD_STREAM_PAYLOAD(cmd);
+                video_fill(band, line->x, line->y, line->w, 1, &line->color);
+                break;
+            }
+            case vid_pre_vline: {
+                const vid_vline_data_t* line = CMD_STREAM_PAYLOAD(cmd);
+                video_fill(band, line->x, line->y, 1, line->h, &line->color);
+                break;
+            }
+            case vid_pre_rect: {
+                const vid_rect_data_t* vid_rect = CMD_STREAM_PAYLOAD(cmd);
+                const color_t* color = &vid_rect->color;
+                SDL_Rect rect = {
+                    vid_rect->bounds.left,
+                    vid_rect->bounds.top,
+                    vid_rect->bounds.width,
+                    vid_rect->bounds.height
+                };
+                if (vid_rect->fill) {
+                    video_fill(band, rect.x, rect.y, rect.w, rect.h, color);
+                } else {
+                    video_fill(band, rect.x,          rect.y,          1,          rect.h, color);
+                    video_fill(band, rect.x + rect.w, rect.y,          1,          rect.h, color);
+                    video_fill(band, rect.x,          rect.y,          rect.w,     1,      color);
+                    video_fill(band, rect.x,          rect.y + rect.h, rect.w + 1, 1,      color);
+                }
+                break;
+            }
+            default: {
+                break;
+            }
         }
+    }
+}
+
+static void video_render_band(void* user, uint32_t index) {
+    const vid_band_t* band = &s_bands[index];
+
+    video_bg_draw(band);
+    video_fg_restore(band);
+    video_fg_update(band);
+    if (s_indexed)
+        video_fg_expand(band);
+    video_pre_commands(band);
+}
 
-    next_tile:
-        tx += TILE_WIDTH;
-        if (tx == SCREEN_WIDTH) {
-            tx = 0;
-            ty += TILE_HEIGHT;
+static void video_post_commands(struct SDL_Renderer* renderer, uint32_t ticks) {
+    if (renderer == NULL || s_font == NULL) {
+        cmd_stream_reset(&s_post_commands);
+        return;
+    }
+
+    uint32_t offset = 0;
+    const cmd_header_t* cmd;
+    while ((cmd = cmd_stream_next(&s_post_commands, &offset)) != NULL) {
+        switch (cmd->type) {
+            case vid_post_text: {
+                const vid_text_data_t* text = CMD_STREAM_PAYLOAD(cmd);
+                text_cache_draw(text->x, text->y, text->color, text->buffer);
+                break;
+            }
+            default: {
+                break;
+            }
         }
     }
 
-    SDL_UnlockSurface(s_bg_surface);
-
-    SDL_BlitSurface(s_bg_surface, NULL, s_fg_surface, NULL);
+    cmd_stream_reset(&s_post_commands);
 }
 
-static void video_fg_update(uint32_t ticks) {
-    for (uint32_t i = 0; i < SPRITE_MAX; i++) {
-        spr_control_block_t* block = &s_spr_control[i];
-
-        if ((block->flags & f_spr_enabled) == 0)
-            continue;
-
-        if (!video_draw_spr(
-                s_fg_surface,
-                block->x,
-                block->y,
-                block->tile,
-                block->palette,
-                block->flags)) {
-            continue;
-        }
-
-        block->flags &= ~f_spr_changed;
+static void video_atlas_sprites(
+        SDL_Renderer* renderer,
+        spr_control_block_t* const* order,
+        uint32_t count) {
+    blit_clip_t clip;
+    video_spr_clip(&clip);
+    SDL_Rect rect = {clip.x0, clip.y0, clip.x1 - clip.x0, clip.y1 - clip.y0};
+    SDL_RenderSetClipRect(renderer, &rect);
+
+    for (uint32_t n = 0; n < count; n++) {
+        const spr_control_block_t* block = order[n];
+
+        video_atlas_sprite(
+            block->x,
+            block->y,
+            block->tile,
+            block->palette,
+            video_spr_blit_flags(block->flags));
     }
+
+    SDL_RenderSetClipRect(renderer, NULL);
 }
 
-static void vline(uint16_t y, uint16_t x, uint16_t h, color_t* color) {
-    for (uint32_t h1 = 0; h1 < h; h1++) {
-        uint8_t* p = s_fg_surface->pixels + ((y + h1) * s_fg_surface->pitch + (x * 4));
-        *p++ = color->r;
-        *p++ = color->g;
-        *p++ = color->b;
-        *p = color->a;
-    }
+static void video_atlas_color(SDL_Renderer* renderer, const color_t* color) {
+    // the cpu path stores r, g, b, a bytes that the streaming texture
+    // reads as ARGB8888; draw what it would show.
+    SDL_SetRenderDrawColor(renderer, color->b, color->g, color->r, color->a);
 }
 
-static void hline(uint16_t y, uint16_t x, uint16_t w, color_t* color) {
-    uint8_t* p = s_fg_surface->pixels + ((y + 0) * s_fg_surface->pitch + (x * 4));
-    for (uint32_t w1 = 0; w1 < w; w1++) {
-        *p++ = color->r;
-        *p++ = color->g;
-        *p++ = color->b;
-        *p++ = color->a;
-    }
+static void video_atlas_span(
+        SDL_Renderer* renderer,
+        const color_t* color,
+        int32_t x,
+        int32_t y,
+        int32_t w,
+        int32_t h) {
+    // lines are axis aligned, so fill them as rects; SDL's line
+    // rasterizer is free to drop single-pixel lines.
+    if (w <= 0 || h <= 0)
+        return;
+    SDL_Rect rect = {x, y, w, h};
+    video_atlas_color(renderer, color);
+    SDL_RenderFillRect(renderer, &rect);
 }
 
-static void video_pre_commands(uint32_t ticks) {
-    for (uint16_t i = 0; i < s_current_pre_command; i++) {
-        vid_pre_command_t* cmd = &s_pre_commands[i];
+static void video_atlas_commands(SDL_Renderer* renderer) {
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+
+    blit_clip_t clip;
+    video_spr_clip(&clip);
+    SDL_Rect spr_rect = {clip.x0, clip.y0, clip.x1 - clip.x0, clip.y1 - clip.y0};
+
+    uint32_t offset = 0;
+    const cmd_header_t* cmd;
+    while ((cmd = cmd_stream_next(&s_pre_commands, &offset)) != NULL) {
         switch (cmd->type) {
             case vid_pre_spr: {
-                const vid_tile_data_t* tile = &cmd->data.tile;
-                video_draw_spr(
-                    s_fg_surface,
+                const vid_tile_data_t* tile = CMD_STREAM_PAYLOAD(cmd);
+                SDL_RenderSetClipRect(renderer, &spr_rect);
+                video_atlas_sprite(
                     tile->x,
                     tile->y,
                     tile->tile,
                     tile->palette,
-                    tile->flags);
+                    video_spr_blit_flags(tile->flags));
+                SDL_RenderSetClipRect(renderer, NULL);
                 break;
             }
             case vid_pre_tile: {
-                const vid_tile_data_t* tile = &cmd->data.tile;
-                video_draw_tile(
-                    s_fg_surface,
+                const vid_tile_data_t* tile = CMD_STREAM_PAYLOAD(cmd);
+                video_atlas_tile(
                     tile->x,
                     tile->y,
                     tile->tile,
                     tile->palette,
-                    tile->flags);
+                    video_tile_cache_flags(tile->flags));
                 break;
             }
             case vid_pre_hline: {
-                vid_hline_data_t* line = &cmd->data.hline;
-                hline(line->y, line->x, line->w, &line->color);
+                const vid_hline_data_t* line = CMD_STREAM_PAYLOAD(cmd);
+                video_atlas_span(renderer, &line->color, line->x, line->y, line->w, 1);
                 break;
             }
             case vid_pre_vline: {
-                vid_vline_data_t* line = &cmd->data.vline;
-                vline(line->y, line->x, line->h, &line->color);
+                const vid_vline_data_t* line = CMD_STREAM_PAYLOAD(cmd);
+                video_atlas_span(renderer, &line->color, line->x, line->y, 1, line->h);
                 break;
             }
             case vid_pre_rect: {
-                vid_rect_data_t* vid_rect = &cmd->data.rect;
+                const vid_rect_data_t* vid_rect = CMD_STREAM_PAYLOAD(cmd);
+                const color_t* color = &vid_rect->color;
                 SDL_Rect rect = {
                     vid_rect->bounds.left,
                     vid_rect->bounds.top,
                     vid_rect->bounds.width,
                     vid_rect->bounds.height
                 };
-                if (cmd->data.rect.fill) {
-                    for (uint32_t l = 0; l < rect.h; l++)
-                        hline(rect.y + l, rect.x, rect.w, &vid_rect->color);
+                if (vid_rect->fill) {
+                    video_atlas_span(renderer, color, rect.x, rect.y, rect.w, rect.h);
                 } else {
-                    vline(rect.y,          rect.x,          rect.h,     &vid_rect->color);
-                    vline(rect.y,          rect.x + rect.w, rect.h,     &vid_rect->color);
-                    hline(rect.y,          rect.x,          rect.w,     &vid_rect->color);
-                    hline(rect.y + rect.h, rect.x,          rect.w + 1, &vid_rect->color);
+                    video_atlas_span(renderer, color, rect.x,          rect.y,          1,          rect.h);
+                    video_atlas_span(renderer, color, rect.x + rect.w, rect.y,          1,          rect.h);
+                    video_atlas_span(renderer, color, rect.x,          rect.y,          rect.w,     1);
+                    video_atlas_span(renderer, color, rect.x,          rect.y + rect.h, rect.w + 1, 1);
                 }
                 break;
             }
@@ -400,64 +1566,201 @@ static void video_pre_commands(uint32_t ticks) {
         }
     }
 
-    s_current_pre_command = 0;
+    cmd_stream_reset(&s_pre_commands);
 }
 
-static void video_post_commands(struct SDL_Renderer* renderer, uint32_t ticks) {
-    for (uint16_t i = 0; i < s_current_post_command; i++) {
-        vid_post_command_t* cmd = &s_post_commands[i];
-        switch (cmd->type) {
-            case vid_post_text: {
-                vid_text_data_t* text = &cmd->data.text;
-                FC_DrawColor(
-                    s_font,
-                    renderer,
-                    text->x,
-                    text->y,
-                    FC_MakeColor(
-                        text->color.r,
-                        text->color.g,
-                        text->color.b,
-                        text->color.a),
-                    text->buffer);
-                break;
-            }
-            default: {
-                break;
+// a playfield, or a scroll without a target to wrap, draws each visible
+// cell straight to the screen at the scroll offset.
+static void video_atlas_bg_cells(void) {
+    const int32_t left = video_floor_div(s_scroll_x, TILE_WIDTH);
+    const int32_t top = video_floor_div(s_scroll_y, TILE_HEIGHT);
+    const int32_t ox = s_scroll_x - left * TILE_WIDTH;
+    const int32_t oy = s_scroll_y - top * TILE_HEIGHT;
+
+    for (int32_t cy = 0; cy <= TILE_MAP_HEIGHT; cy++) {
+        for (int32_t cx = 0; cx <= TILE_MAP_WIDTH; cx++) {
+            uint16_t tile_index;
+            uint8_t palette_index;
+            uint8_t flags;
+            if (s_playfield != NULL) {
+                const uint32_t row = video_wrap(top + cy, s_playfield_rows);
+                const uint32_t col = video_wrap(left + cx, s_playfield_cols);
+                const tile_map_entry_t* entry = &s_playfield[row * s_playfield_cols + col];
+                tile_index = entry->tile;
+                palette_index = entry->palette;
+                flags = entry->flags;
+            } else {
+                const uint32_t row = video_wrap(top + cy, TILE_MAP_HEIGHT);
+                const uint32_t col = video_wrap(left + cx, TILE_MAP_WIDTH);
+                const bg_control_block_t* block = &s_bg_control[row * TILE_MAP_WIDTH + col];
+                video_bg_source(block, &tile_index, &palette_index);
+                flags = block->flags;
             }
+            video_atlas_tile(
+                cx * TILE_WIDTH - ox,
+                cy * TILE_HEIGHT - oy,
+                tile_index,
+                palette_index,
+                video_tile_cache_flags(flags));
+        }
+    }
+}
+
+// the target holds the map at 0, 0; screen (x, y) shows its pixel
+// ((x + scroll_x) & 255, (y + scroll_y) & 255), so it goes up in as
+// many as four wrapped pieces.
+static void video_atlas_bg_copy(SDL_Renderer* renderer) {
+    const int32_t ox = s_scroll_x & (SCREEN_WIDTH - 1);
+    const int32_t oy = s_scroll_y & (SCREEN_HEIGHT - 1);
+    const int32_t xs[2][3] = {{ox, 0, SCREEN_WIDTH - ox}, {0, SCREEN_WIDTH - ox, ox}};
+    const int32_t ys[2][3] = {{oy, 0, SCREEN_HEIGHT - oy}, {0, SCREEN_HEIGHT - oy, oy}};
+
+    // {source, destination, size} along each axis
+    for (uint32_t j = 0; j < 2; j++) {
+        for (uint32_t i = 0; i < 2; i++) {
+            if (xs[i][2] == 0 || ys[j][2] == 0)
+                continue;
+            const SDL_Rect src = {xs[i][0], ys[j][0], xs[i][2], ys[j][2]};
+            const SDL_Rect dst = {xs[i][1], ys[j][1], xs[i][2], ys[j][2]};
+            SDL_RenderCopy(renderer, s_bg_target, &src, &dst);
         }
     }
+}
+
+static void video_atlas_bg(SDL_Renderer* renderer) {
+    const bool scrolled = s_scroll_x != 0 || s_scroll_y != 0;
+    if (s_playfield != NULL || (scrolled && s_bg_target == NULL)) {
+        video_atlas_bg_cells();
+        return;
+    }
+
+    if (s_bg_target != NULL)
+        SDL_SetRenderTarget(renderer, s_bg_target);
+
+    for (uint32_t i = 0; i < TILE_MAP_SIZE; i++) {
+        if (s_bg_redraw[i] == 0 && s_bg_target != NULL)
+            continue;
+        s_bg_redraw[i] = 0;
+
+        uint16_t tile_index;
+        uint8_t palette_index;
+        const bg_control_block_t* block = &s_bg_control[i];
+        video_bg_source(block, &tile_index, &palette_index);
+        video_atlas_tile(
+            (int32_t) ((i % TILE_MAP_WIDTH) * TILE_WIDTH),
+            (int32_t) ((i / TILE_MAP_WIDTH) * TILE_HEIGHT),
+            tile_index,
+            palette_index,
+            video_tile_cache_flags(block->flags));
+    }
 
-    s_current_post_command = 0;
+    if (s_bg_target != NULL) {
+        SDL_SetRenderTarget(renderer, NULL);
+        video_atlas_bg_copy(renderer);
+    }
 }
 
-void video_init(struct SDL_Renderer* renderer) {
-//    rect_t temp = {.left = 64, .top = 32, .width = 128, .height = 224};
-//    video_clip_rect(temp);
+static void video_atlas_update(video_sink_t* sink, uint32_t ticks) {
+    SDL_Renderer* renderer = sink->renderer;
+
+    // sprites behind the bg need its color-0 mask, which only the cpu
+    // path has; they sort first, so checking the head is enough.
+    uint32_t count;
+    spr_control_block_t* const* order = video_sprite_sort(&count);
+    if (count > 0 && order[0]->priority == SPR_PRIORITY_BEHIND_BG) {
+        log_warn(category_video, "atlas renderer cannot draw sprites behind the bg; using cpu.");
+        video_renderer(video_renderer_cpu);
+        video_update(sink, ticks);
+        return;
+    }
 
-    video_clip_rect_clear();
+    video_bg_update(ticks);
+    memset(s_fg_restore, 0, sizeof(s_fg_restore));
+
+    video_atlas_bg(renderer);
+    video_atlas_sprites(renderer, order, count);
+    video_atlas_commands(renderer);
+
+    s_stats.restored_bytes = 0;
+    s_stats.uploaded_bytes = 0;
+    video_stats_update();
+
+    video_post_commands(renderer, ticks);
+    sink->present(sink);
+}
+
+static void video_surfaces_create(void) {
+    const char* name = SDL_GetPixelFormatName(pixel_format());
+    if (s_bg_surface != NULL)
+        SDL_FreeSurface(s_bg_surface);
+    if (s_fg_surface != NULL)
+        SDL_FreeSurface(s_fg_surface);
 
-    log_message(category_video, "allocate RGBA8888 bg surface.");
+    log_message(category_video, "allocate %s bg surface.", name);
     s_bg_surface = SDL_CreateRGBSurfaceWithFormat(
         0,
         SCREEN_WIDTH,
         SCREEN_HEIGHT,
         32,
-        SDL_PIXELFORMAT_RGBA8888);
+        pixel_format());
     log_message(category_video, "set s_bg_surface blend mode: none.");
     SDL_SetSurfaceBlendMode(s_bg_surface, SDL_BLENDMODE_NONE);
 
-    log_message(category_video, "allocate RGBA8888 fg surface.");
+    log_message(category_video, "allocate %s fg surface.", name);
     s_fg_surface = SDL_CreateRGBSurfaceWithFormat(
         0,
         SCREEN_WIDTH,
         SCREEN_HEIGHT,
         32,
-        SDL_PIXELFORMAT_RGBA8888);
+        pixel_format());
     log_message(category_video, "set s_fg_surface blend mode: none.");
     SDL_SetSurfaceBlendMode(s_fg_surface, SDL_BLENDMODE_NONE);
     log_message(category_video, "set s_bg_surface RLE enabled.");
     SDL_SetSurfaceRLE(s_fg_surface, SDL_TRUE);
+}
+
+void video_init(struct SDL_Renderer* renderer) {
+//    rect_t temp = {.left = 64, .top = 32, .width = 128, .height = 224};
+//    video_clip_rect(temp);
+
+    video_clip_rect_clear();
+
+    log_message(category_video, "initialize command streams: %d byte cap.", s_command_limit);
+    cmd_stream_init(&s_pre_commands, s_command_limit);
+    cmd_stream_init(&s_post_commands, s_command_limit);
+
+    log_message(category_video, "initialize tile cache: %d slots.", TILE_CACHE_SLOTS);
+    tile_cache_init();
+
+    // the window's format replaces this once the sink is known
+    pixel_format_set(SDL_PIXELFORMAT_ARGB8888);
+
+    log_message(category_video, "initialize sprite blitter.");
+    blit_init();
+
+    video_surfaces_create();
+
+    s_renderer = renderer;
+    video_render_threads(1);
+
+    // the indexed renderer draws from these, and sprites behind the bg
+    // test against them in either mode
+    for (uint32_t i = 0; i < TILE_MAX; i++)
+        video_tile_indexes((uint16_t) i);
+
+    video_spr_reserve(SPRITE_MAX);
+
+    memset(s_bg_redraw, 0, sizeof(s_bg_redraw));
+    memset(s_fg_restore, 1, sizeof(s_fg_restore));
+    memset(s_fg_touched, 0, sizeof(s_fg_touched));
+    memset(s_fg_rows, 0, sizeof(s_fg_rows));
+    memset(&s_stats, 0, sizeof(video_stats_t));
+
+    if (renderer == NULL) {
+        log_message(category_video, "no renderer; text post-commands disabled.");
+        s_font = NULL;
+        return;
+    }
 
     log_message(category_video, "load font: assets/press-start-2p.ttf");
     s_font = FC_CreateFont();
@@ -468,40 +1771,196 @@ void video_init(struct SDL_Renderer* renderer) {
         8,
         FC_MakeColor(0xff, 0xff, 0xff, 0xff),
         TTF_STYLE_NORMAL);
+
+    log_message(category_video, "initialize text cache: %d slots.", TEXT_CACHE_SLOTS);
+    text_cache_init(renderer, s_font);
 }
 
-void video_update(window_t* window, uint32_t ticks) {
+void video_update(video_sink_t* sink, uint32_t ticks) {
+    if (s_renderer_type == video_renderer_atlas && sink->renderer != NULL) {
+        video_atlas_update(sink, ticks);
+        return;
+    }
+
     video_bg_update(ticks);
+    if (s_playfield != NULL)
+        video_ring_update();
+
+    // a vertical scroll has bands restoring bg rows other bands draw, so
+    // the bg is brought up to date before the bands run.
+    if (s_band_count > 1 && (s_scroll_y & (SCREEN_HEIGHT - 1)) != 0) {
+        const vid_band_t screen = {.top = 0, .bottom = SCREEN_HEIGHT};
+        video_bg_draw(&screen);
+    }
 
+    video_fg_prepare();
+
+    SDL_LockSurface(s_bg_surface);
     SDL_LockSurface(s_fg_surface);
-    video_fg_update(ticks);
-    video_pre_commands(ticks);
+    s_fg_target.pixels = s_fg_surface->pixels;
+    s_fg_target.pitch = s_fg_surface->pitch;
+    const bool locked = video_fg_lock(sink);
+    if (s_band_count > 1)
+        video_pool_run(video_render_band, NULL, s_band_count);
+    else
+        video_render_band(NULL, 0);
+    cmd_stream_reset(&s_pre_commands);
+    if (locked)
+        sink->unlock(sink);
+    else
+        video_fg_upload(sink);
     SDL_UnlockSurface(s_fg_surface);
+    SDL_UnlockSurface(s_bg_surface);
+
+    video_stats_update();
+
+    sink->compose(sink);
+    video_post_commands(sink->renderer, ticks);
+    sink->present(sink);
+}
+
+void video_render_threads(uint32_t count) {
+    if (count > VIDEO_POOL_MAX + 1)
+        count = VIDEO_POOL_MAX + 1;
+
+    if (count <= 1 || !video_pool_init(count - 1)) {
+        video_pool_shutdown();
+        s_bands[0].top = 0;
+        s_bands[0].bottom = SCREEN_HEIGHT;
+        s_band_count = 1;
+        return;
+    }
+
+    // a few bands per thread so uneven bands balance out
+    s_band_count = count * 4;
+    if (s_band_count > TILE_MAP_HEIGHT)
+        s_band_count = TILE_MAP_HEIGHT;
+    for (uint32_t i = 0; i < s_band_count; i++) {
+        s_bands[i].top = (uint16_t) (i * TILE_MAP_HEIGHT / s_band_count * TILE_HEIGHT);
+        s_bands[i].bottom = (uint16_t) ((i + 1) * TILE_MAP_HEIGHT / s_band_count * TILE_HEIGHT);
+    }
+
+    log_message(category_video, "banded renderer: %d threads, %d bands.", count, s_band_count);
+}
+
+void video_command_limit(uint32_t bytes) {
+    if (bytes == 0)
+        bytes = COMMAND_BYTES_DEFAULT;
+    s_command_limit = bytes;
+    cmd_stream_limit(&s_pre_commands, bytes);
+    cmd_stream_limit(&s_post_commands, bytes);
+}
 
-    SDL_UpdateTexture(
-        window->texture,
-        NULL,
-        s_fg_surface->pixels,
-        s_fg_surface->pitch);
+const char* video_renderer_name(video_renderer_t type) {
+    switch (type) {
+        case video_renderer_cpu:
+            return "cpu";
+        case video_renderer_atlas:
+            return "atlas";
+        default:
+            return "unknown";
+    }
+}
+
+bool video_renderer_parse(const char* value, video_renderer_t* type) {
+    assert(value != NULL);
+    assert(type != NULL);
+
+    for (video_renderer_t t = video_renderer_cpu; t <= video_renderer_atlas; t++) {
+        if (strcmp(value, video_renderer_name(t)) == 0) {
+            *type = t;
+            return true;
+        }
+    }
+
+    return false;
+}
 
-    SDL_RenderCopy(
-        window->renderer,
-        window->texture,
-        NULL,
-        NULL);
+static bool video_raster_active(void) {
+    for (uint32_t cy = 0; cy < TILE_MAP_HEIGHT; cy++) {
+        if (s_raster_lines[cy] != 0)
+            return true;
+    }
+    return false;
+}
+
+bool video_renderer(video_renderer_t type) {
+    video_atlas_shutdown();
+    if (s_bg_target != NULL) {
+        SDL_DestroyTexture(s_bg_target);
+        s_bg_target = NULL;
+    }
 
-    video_post_commands(window->renderer, ticks);
+    s_renderer_type = video_renderer_cpu;
+    memset(s_bg_dirty, 0xff, sizeof(s_bg_dirty));
+    if (s_playfield != NULL)
+        memset(s_ring_dirty, 0xff, sizeof(s_ring_dirty));
+    memset(s_fg_restore, 1, sizeof(s_fg_restore));
+
+    if (type == video_renderer_atlas) {
+        // the atlas draws whole tiles; per-line effects need the cpu path
+        if (video_raster_active()) {
+            log_warn(category_video, "raster effects are active; using cpu.");
+            return false;
+        }
+        if (!video_atlas_init(s_renderer)) {
+            log_warn(category_video, "atlas renderer needs an SDL renderer; using cpu.");
+            return false;
+        }
+
+        if (SDL_RenderTargetSupported(s_renderer)) {
+            s_bg_target = video_atlas_texture(
+                SDL_TEXTUREACCESS_TARGET,
+                SCREEN_WIDTH,
+                SCREEN_HEIGHT);
+            SDL_SetTextureBlendMode(s_bg_target, SDL_BLENDMODE_NONE);
+        }
+        if (s_bg_target == NULL)
+            log_message(category_video, "no render targets; atlas redraws the full bg each frame.");
+        s_renderer_type = video_renderer_atlas;
+    }
 
-    SDL_RenderPresent(window->renderer);
+    log_message(category_video, "renderer: %s.", video_renderer_name(s_renderer_type));
+    return true;
 }
 
 void video_shutdown(void) {
+    video_atlas_shutdown();
+    if (s_bg_target != NULL) {
+        SDL_DestroyTexture(s_bg_target);
+        s_bg_target = NULL;
+    }
+    video_pool_shutdown();
+    log_message(category_video, "free command streams.");
+    cmd_stream_free(&s_pre_commands);
+    cmd_stream_free(&s_post_commands);
     log_message(category_video, "free bg surface.");
     SDL_FreeSurface(s_bg_surface);
+    s_bg_surface = NULL;
     log_message(category_video, "free fg surface.");
     SDL_FreeSurface(s_fg_surface);
-    log_message(category_video, "free font.");
-    FC_FreeFont(s_font);
+    s_fg_surface = NULL;
+    for (uint32_t i = 0; i < TILE_MAP_MAX; i++) {
+        free(s_bg_cache[i].pixels);
+        s_bg_cache[i].pixels = NULL;
+        s_bg_cache[i].source = NULL;
+    }
+    for (uint32_t c = 0; c < SPR_VIRTUAL_CHUNKS; c++) {
+        free(s_spr_chunks[c]);
+        s_spr_chunks[c] = NULL;
+    }
+    free(s_spr_order);
+    free(s_spr_spans);
+    s_spr_order = NULL;
+    s_spr_spans = NULL;
+    s_spr_virtual_count = 0;
+    s_spr_virtual_capacity = 0;
+    text_cache_shutdown();
+    if (s_font != NULL) {
+        log_message(category_video, "free font.");
+        FC_FreeFont(s_font);
+        s_font = NULL;
+    }
 }
 
 void video_reset_sprites(void) {
@@ -510,8 +1969,18 @@ void video_reset_sprites(void) {
         s_spr_control[i].y = 0;
         s_spr_control[i].tile = 0;
         s_spr_control[i].palette = 0;
+        s_spr_control[i].priority = 0;
         s_spr_control[i].flags = f_spr_none;
     }
+    for (uint32_t i = 0; i < s_spr_virtual_count; i += SPRITE_MAX) {
+        const uint32_t count = video_spr_chunk_count(i);
+        memset(s_spr_chunks[i / SPRITE_MAX], 0, count * sizeof(spr_control_block_t));
+    }
+    s_spr_virtual_count = 0;
+}
+
+void video_sprite_limit(uint8_t per_line) {
+    s_spr_line_limit = per_line;
 }
 
 void video_clip_rect_clear(void) {
@@ -528,13 +1997,220 @@ void video_clip_rect(rect_t rect) {
     s_clip_rect.height = rect.height;
 }
 
+static vid_bg_cache_t* video_bg_cache_slot(const tile_map_t* map) {
+    for (uint32_t i = 0; i < TILE_MAP_MAX; i++) {
+        if (s_bg_cache[i].source == map)
+            return &s_bg_cache[i];
+    }
+
+    vid_bg_cache_t* slot = &s_bg_cache[s_bg_cache_next];
+    s_bg_cache_next = (s_bg_cache_next + 1) % TILE_MAP_MAX;
+    slot->source = NULL;
+    if (slot->pixels == NULL)
+        slot->pixels = malloc(SCREEN_WIDTH * SCREEN_HEIGHT * 4);
+    return slot;
+}
+
+static void video_bg_cache_invalidate(uint64_t palettes) {
+    for (uint32_t i = 0; i < TILE_MAP_MAX; i++) {
+        if ((s_bg_cache[i].palettes & palettes) != 0)
+            s_bg_cache[i].source = NULL;
+    }
+}
+
+// brings the dirty cells of the live bg buffer up to date, copying them
+// from a cached render when one is given; false if any cell failed to
+// draw and was left dirty for video_bg_update to retry.
+static bool video_bg_redraw_dirty(const uint8_t* cached, uint32_t* cells) {
+    const vid_band_t band = {.top = 0, .bottom = SCREEN_HEIGHT};
+    const blit_target_t target = {
+        .pixels = s_bg_surface->pixels,
+        .pitch = s_bg_surface->pitch
+    };
+    const uint32_t bpp = s_indexed ? 1 : 4;
+    const uint32_t pitch = s_indexed ? SCREEN_WIDTH : (uint32_t) s_bg_surface->pitch;
+    uint8_t* live = s_indexed ? s_bg_indexes : target.pixels;
+
+    bool complete = true;
+    *cells = 0;
+    for (uint32_t cy = 0; cy < TILE_MAP_HEIGHT; cy++) {
+        uint32_t bits = s_bg_dirty[cy];
+        while (bits != 0) {
+            const uint32_t cx = video_bg_ctz(bits);
+            const uint32_t i = cy * TILE_MAP_WIDTH + cx;
+            bits &= bits - 1;
+
+            const uint16_t tx = (uint16_t) (cx * TILE_WIDTH);
+            const uint16_t ty = (uint16_t) (cy * TILE_HEIGHT);
+            if (cached != NULL) {
+                const uint32_t offset = ty * pitch + tx * bpp;
+                for (uint32_t y = 0; y < TILE_HEIGHT; y++)
+                    memcpy(live + offset + y * pitch, cached + offset + y * pitch, TILE_WIDTH * bpp);
+            } else {
+                const bg_control_block_t* block = &s_bg_control[i];
+                uint16_t tile_index;
+                uint8_t palette_index;
+                video_bg_source(block, &tile_index, &palette_index);
+                const bool drawn = s_indexed ?
+                    video_draw_tile_indexed(&band, tx, ty, tile_index, palette_index, block->flags) :
+                    video_draw_tile(&target, &band, tx, ty, tile_index, palette_index, block->flags);
+                if (!drawn) {
+                    complete = false;
+                    continue;
+                }
+            }
+
+            s_bg_dirty[cy] &= ~(1u << cx);
+            video_fg_restore_cell(i);
+            (*cells)++;
+        }
+    }
+    return complete;
+}
+
 void video_bg_set(const tile_map_t* map) {
     assert(map != NULL);
 
+    // only cells that differ from the current map get redrawn; cells that
+    // were already dirty stay dirty.
+    uint64_t palettes = 0;
     for (uint32_t i = 0; i < TILE_MAP_SIZE; i++) {
-        s_bg_control[i].tile = map->data[i].tile;
-        s_bg_control[i].palette = map->data[i].palette;
-        s_bg_control[i].flags = map->data[i].flags | f_bg_enabled | f_bg_changed;
+        const tile_map_entry_t* entry = &map->data[i];
+        bg_control_block_t* block = &s_bg_control[i];
+        const uint8_t flags = (uint8_t) (entry->flags | f_bg_enabled);
+        palettes |= 1ull << (entry->palette % 64);
+        if (block->tile == entry->tile && block->palette == entry->palette && block->flags == flags)
+            continue;
+
+        block->tile = entry->tile;
+        block->palette = entry->palette;
+        block->flags = flags;
+        video_bg_dirty(i);
+    }
+
+    // the atlas renderer redraws its target from the dirty bits, and an
+    // attached playfield owns the bg surface until it detaches.
+    if (s_renderer_type != video_renderer_cpu || s_playfield != NULL) {
+        s_stats.bg_set_cells = 0;
+        for (uint32_t cy = 0; cy < TILE_MAP_HEIGHT; cy++) {
+            for (uint32_t bits = s_bg_dirty[cy]; bits != 0; bits &= bits - 1)
+                s_stats.bg_set_cells++;
+        }
+        return;
+    }
+
+    uint8_t* live = s_indexed ? s_bg_indexes : (uint8_t*) s_bg_surface->pixels;
+    const size_t size = s_indexed ?
+        sizeof(s_bg_indexes) :
+        (size_t) s_bg_surface->pitch * SCREEN_HEIGHT;
+
+    vid_bg_cache_t* slot = video_bg_cache_slot(map);
+    if (slot->source == map
+            && slot->indexed == s_indexed
+            && memcmp(&slot->map, map, sizeof(tile_map_t)) == 0) {
+        video_bg_redraw_dirty(slot->pixels, &s_stats.bg_set_cells);
+        s_stats.bg_cache_hits++;
+        return;
+    }
+
+    s_stats.bg_cache_misses++;
+    slot->source = NULL;
+    if (!video_bg_redraw_dirty(NULL, &s_stats.bg_set_cells) || slot->pixels == NULL)
+        return;
+
+    memcpy(slot->pixels, live, size);
+    memcpy(&slot->map, map, sizeof(tile_map_t));
+    slot->palettes = palettes;
+    slot->indexed = s_indexed;
+    slot->source = map;
+}
+
+void video_scroll(int32_t y, int32_t x) {
+    if (x == s_scroll_x && y == s_scroll_y)
+        return;
+
+    if (s_playfield != NULL) {
+        if (x > s_scroll_x)
+            video_ring_expose(s_scroll_x + SCREEN_WIDTH, x + SCREEN_WIDTH, true);
+        else if (x < s_scroll_x)
+            video_ring_expose(x, s_scroll_x, true);
+        if (y > s_scroll_y)
+            video_ring_expose(s_scroll_y + SCREEN_HEIGHT, y + SCREEN_HEIGHT, false);
+        else if (y < s_scroll_y)
+            video_ring_expose(y, s_scroll_y, false);
+    }
+
+    s_scroll_x = x;
+    s_scroll_y = y;
+    memset(s_fg_restore, 1, sizeof(s_fg_restore));
+}
+
+void video_raster_line(uint8_t y, int16_t scroll_x, int16_t palette) {
+    vid_raster_t* line = &s_raster[y];
+    const uint8_t bit = (uint8_t) (1u << (y % TILE_HEIGHT));
+    const bool active = (s_raster_lines[y / TILE_HEIGHT] & bit) != 0;
+    if (palette < 0)
+        palette = -1;
+    if (scroll_x == 0 && palette < 0) {
+        if (!active)
+            return;
+        s_raster_lines[y / TILE_HEIGHT] &= (uint8_t) ~bit;
+    } else {
+        if (active && line->scroll_x == scroll_x && line->palette == palette)
+            return;
+        s_raster_lines[y / TILE_HEIGHT] |= bit;
+        if (s_renderer_type == video_renderer_atlas) {
+            log_warn(category_video, "atlas renderer cannot draw raster effects; using cpu.");
+            video_renderer(video_renderer_cpu);
+        }
+    }
+
+    line->scroll_x = scroll_x;
+    line->palette = palette;
+    memset(&s_fg_restore[y / TILE_HEIGHT * TILE_MAP_WIDTH], 1, TILE_MAP_WIDTH);
+}
+
+void video_raster_clear(void) {
+    for (uint32_t cy = 0; cy < TILE_MAP_HEIGHT; cy++) {
+        if (s_raster_lines[cy] == 0)
+            continue;
+        for (uint32_t y = 0; y < TILE_HEIGHT; y++)
+            video_raster_line((uint8_t) (cy * TILE_HEIGHT + y), 0, -1);
+    }
+}
+
+void video_bg_playfield(const tile_map_entry_t* data, uint16_t rows, uint16_t cols) {
+    if (data == NULL || rows == 0 || cols == 0) {
+        s_playfield = NULL;
+        s_playfield_rows = 0;
+        s_playfield_cols = 0;
+        memset(s_bg_dirty, 0xff, sizeof(s_bg_dirty));
+    } else {
+        s_playfield = data;
+        s_playfield_rows = rows;
+        s_playfield_cols = cols;
+        memset(s_ring_dirty, 0xff, sizeof(s_ring_dirty));
+        log_message(category_video, "attach %dx%d playfield.", cols, rows);
+    }
+    memset(s_fg_restore, 1, sizeof(s_fg_restore));
+}
+
+void video_bg_playfield_mark(uint16_t y, uint16_t x) {
+    if (s_playfield == NULL)
+        return;
+
+    // the playfield wraps, so a cell may be on screen more than once
+    uint32_t columns = 0;
+    const int32_t left = video_floor_div(s_scroll_x, TILE_WIDTH);
+    for (int32_t cx = left; cx <= left + TILE_MAP_WIDTH; cx++) {
+        if (video_wrap(cx, s_playfield_cols) == x)
+            columns |= 1u << video_wrap(cx, TILE_MAP_WIDTH);
+    }
+
+    const int32_t top = video_floor_div(s_scroll_y, TILE_HEIGHT);
+    for (int32_t cy = top; cy <= top + TILE_MAP_HEIGHT; cy++) {
+        if (video_wrap(cy, s_playfield_rows) == y)
+            s_ring_dirty[video_wrap(cy, TILE_MAP_HEIGHT)] |= columns;
     }
 }
 
@@ -542,70 +2218,294 @@ void video_bg_fill(uint16_t tile, uint8_t palette) {
     for (uint32_t i = 0; i < TILE_MAP_SIZE; i++) {
         s_bg_control[i].tile = tile;
         s_bg_control[i].palette = palette;
-        s_bg_control[i].flags |= f_bg_enabled | f_bg_changed;
+        s_bg_control[i].flags |= f_bg_enabled;
+    }
+    memset(s_bg_dirty, 0xff, sizeof(s_bg_dirty));
+}
+
+static void video_index_colors(uint8_t pal_index) {
+    const pixel_palette_t* native = pixel_format_palette(pal_index);
+    if (native == NULL)
+        return;
+
+    memcpy(&s_index_colors[pal_index << 2], native->opaque, sizeof(native->opaque));
+    s_index_colors_changed = true;
+}
+
+void video_indexed(bool enabled) {
+    s_indexed = enabled;
+    for (uint32_t i = 0; i < PALETTE_MAX; i++)
+        video_index_colors((uint8_t) i);
+
+    memset(s_bg_dirty, 0xff, sizeof(s_bg_dirty));
+    if (s_playfield != NULL)
+        memset(s_ring_dirty, 0xff, sizeof(s_ring_dirty));
+    memset(s_fg_restore, 1, sizeof(s_fg_restore));
+
+    log_message(category_video, "render mode: %s.", enabled ? "indexed" : "rgba");
+}
+
+void video_zero_copy(bool enabled) {
+    // s_fg_surface goes stale while frames are composed into the texture
+    if (s_zero_copy && !enabled)
+        video_fg_invalidate();
+    s_zero_copy = enabled;
+
+    log_message(category_video, "fg streaming: %s.", enabled ? "zero-copy" : "upload");
+}
+
+void video_pixel_format(uint32_t format) {
+    if (pixel_format_native(format) == pixel_format())
+        return;
+
+    pixel_format_set(format);
+    video_surfaces_create();
+    if (s_bg_target != NULL) {
+        SDL_DestroyTexture(s_bg_target);
+        s_bg_target = video_atlas_texture(
+            SDL_TEXTUREACCESS_TARGET,
+            SCREEN_WIDTH,
+            SCREEN_HEIGHT);
+        SDL_SetTextureBlendMode(s_bg_target, SDL_BLENDMODE_NONE);
+    }
+
+    // everything expanded from the palettes holds the old layout
+    tile_cache_flush();
+    video_bg_cache_invalidate(~0ull);
+    video_atlas_invalidate();
+    for (uint32_t i = 0; i < PALETTE_MAX; i++)
+        video_index_colors((uint8_t) i);
+
+    memset(s_bg_dirty, 0xff, sizeof(s_bg_dirty));
+    if (s_playfield != NULL)
+        memset(s_ring_dirty, 0xff, sizeof(s_ring_dirty));
+    memset(s_fg_restore, 1, sizeof(s_fg_restore));
+}
+
+void video_palette_changed(uint8_t palette) {
+    pixel_format_palette_changed(palette);
+    tile_cache_invalidate_palette(palette);
+    video_bg_cache_invalidate(1ull << (palette % 64));
+    video_atlas_invalidate_palette(palette);
+    if (s_indexed) {
+        video_index_colors(palette);
+        return;
+    }
+    // ring slots keep the colors they were drawn with until redrawn
+    if (s_playfield != NULL)
+        memset(s_ring_dirty, 0xff, sizeof(s_ring_dirty));
+    for (uint32_t i = 0; i < TILE_MAP_SIZE; i++) {
+        if (s_bg_control[i].palette == palette)
+            video_bg_dirty(i);
+    }
+}
+
+void video_tile_bitmap_changed(uint16_t tile) {
+    tile_cache_invalidate_tile(tile);
+    video_bg_cache_invalidate(~0ull);
+    video_atlas_invalidate();
+    if (tile < TILE_MAX)
+        video_tile_indexes(tile);
+    if (s_playfield != NULL)
+        memset(s_ring_dirty, 0xff, sizeof(s_ring_dirty));
+    for (uint32_t i = 0; i < TILE_MAP_SIZE; i++) {
+        if (s_bg_control[i].tile == tile)
+            video_bg_dirty(i);
     }
 }
 
+const video_stats_t* video_stats(void) {
+    return &s_stats;
+}
+
 spr_control_block_t* video_sprite(uint8_t number) {
     return &s_spr_control[number];
 }
 
+static inline uint32_t video_spr_key(const spr_control_block_t* block) {
+    if ((block->flags & f_spr_enabled) == 0)
+        return SPR_KEY_DISABLED;
+    return (uint8_t) block->priority ^ 0x80u;
+}
+
+static void video_spr_count(const spr_control_block_t* blocks, uint32_t count, uint32_t* used) {
+    for (uint32_t i = 0; i < count; i++) {
+        const uint32_t key = video_spr_key(&blocks[i]);
+        s_spr_key_counts[key]++;
+        if (key != SPR_KEY_DISABLED)
+            used[key / 32] |= 1u << (key % 32);
+    }
+}
+
+static void video_spr_scatter(spr_control_block_t* blocks, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++)
+        s_spr_order[s_spr_key_counts[video_spr_key(&blocks[i])]++] = &blocks[i];
+}
+
+// stable radix sort on the priority byte: one counting pass & one scatter
+// pass, with offsets summed only over the keys in use.
+spr_control_block_t* const* video_sprite_sort(uint32_t* count) {
+    uint32_t used[8] = {0};
+    video_spr_count(s_spr_control, SPRITE_MAX, used);
+    for (uint32_t i = 0; i < s_spr_virtual_count; i += SPRITE_MAX)
+        video_spr_count(s_spr_chunks[i / SPRITE_MAX], video_spr_chunk_count(i), used);
+
+    uint32_t offset = 0;
+    for (uint32_t w = 0; w < 8; w++) {
+        uint32_t bits = used[w];
+        while (bits != 0) {
+            const uint32_t key = w * 32 + video_bg_ctz(bits);
+            bits &= bits - 1;
+            const uint32_t n = s_spr_key_counts[key];
+            s_spr_key_counts[key] = offset;
+            offset += n;
+        }
+    }
+    *count = offset;
+    s_spr_key_counts[SPR_KEY_DISABLED] = offset;
+
+    video_spr_scatter(s_spr_control, SPRITE_MAX);
+    for (uint32_t i = 0; i < s_spr_virtual_count; i += SPRITE_MAX)
+        video_spr_scatter(s_spr_chunks[i / SPRITE_MAX], video_spr_chunk_count(i));
+
+    for (uint32_t w = 0; w < 8; w++) {
+        uint32_t bits = used[w];
+        while (bits != 0) {
+            s_spr_key_counts[w * 32 + video_bg_ctz(bits)] = 0;
+            bits &= bits - 1;
+        }
+    }
+    s_spr_key_counts[SPR_KEY_DISABLED] = 0;
+
+    return s_spr_order;
+}
+
+spr_control_block_t* video_sprite_virtual(uint32_t number) {
+    if (number >= s_spr_virtual_capacity) {
+        if (number >= SPRITE_VIRTUAL_MAX || !video_spr_reserve(number + 1))
+            return NULL;
+    }
+    if (number >= s_spr_virtual_count)
+        s_spr_virtual_count = number + 1;
+    return &s_spr_chunks[number / SPRITE_MAX][number % SPRITE_MAX];
+}
+
 bg_control_block_t* video_tile(uint8_t y, uint8_t x) {
     uint32_t index = (uint32_t) (y * TILE_MAP_WIDTH + x);
     return &s_bg_control[index];
 }
 
+void video_bg_mark(uint8_t y, uint8_t x) {
+    if (y < TILE_MAP_HEIGHT && x < TILE_MAP_WIDTH)
+        s_bg_dirty[y] |= 1u << x;
+}
+
+void video_bg_mark_rect(rect_t rect) {
+    int32_t left = rect.left < 0 ? 0 : rect.left;
+    int32_t top = rect.top < 0 ? 0 : rect.top;
+    int32_t right = rect.left + rect.width;
+    int32_t bottom = rect.top + rect.height;
+    if (right > TILE_MAP_WIDTH)
+        right = TILE_MAP_WIDTH;
+    if (bottom > TILE_MAP_HEIGHT)
+        bottom = TILE_MAP_HEIGHT;
+    if (left >= right || top >= bottom)
+        return;
+
+    const uint32_t span = (uint32_t) (right - left);
+    const uint32_t bits = (span >= 32 ? 0xffffffffu : ((1u << span) - 1)) << left;
+    for (int32_t y = top; y < bottom; y++)
+        s_bg_dirty[y] |= bits;
+}
+
 void video_rect(color_t color, rect_t rect) {
-    if (s_current_pre_command >= PRE_COMMANDS_MAX - 1)
+    vid_rect_data_t* vid_rect = cmd_stream_push(&s_pre_commands, vid_pre_rect, sizeof(vid_rect_data_t));
+    if (vid_rect == NULL)
         return;
 
-    s_pre_commands[s_current_pre_command].type = vid_pre_rect;
-    s_pre_commands[s_current_pre_command].data.rect.fill = false;
-    s_pre_commands[s_current_pre_command].data.rect.color = color;
-    s_pre_commands[s_current_pre_command].data.rect.bounds = rect;
-    ++s_current_pre_command;
+    vid_rect->fill = false;
+    vid_rect->color = color;
+    vid_rect->bounds = rect;
+}
+
+static bool video_fill_merge(vid_rect_data_t* last, const color_t* color, const rect_t* rect) {
+    if (memcmp(&last->color, color, sizeof(color_t)) != 0)
+        return false;
+
+    rect_t* bounds = &last->bounds;
+    const int32_t right = bounds->left + bounds->width;
+    const int32_t bottom = bounds->top + bounds->height;
+    const int32_t rect_right = rect->left + rect->width;
+    const int32_t rect_bottom = rect->top + rect->height;
+
+    // only merge when the union is itself a rect: same columns and touching
+    // rows, same rows and touching columns, or one inside the other.
+    int32_t left = bounds->left < rect->left ? bounds->left : rect->left;
+    int32_t top = bounds->top < rect->top ? bounds->top : rect->top;
+    int32_t union_right = right > rect_right ? right : rect_right;
+    int32_t union_bottom = bottom > rect_bottom ? bottom : rect_bottom;
+    if (rect->left >= bounds->left && rect_right <= right
+            && rect->top >= bounds->top && rect_bottom <= bottom) {
+        return true;
+    } else if (bounds->left >= rect->left && right <= rect_right
+            && bounds->top >= rect->top && bottom <= rect_bottom) {
+    } else if (bounds->left == rect->left && right == rect_right
+            && rect->top <= bottom && top <= rect_bottom) {
+    } else if (bounds->top == rect->top && bottom == rect_bottom
+            && rect->left <= right && left <= rect_right) {
+    } else {
+        return false;
+    }
+
+    if (union_right - left > INT16_MAX || union_bottom - top > INT16_MAX)
+        return false;
+
+    bounds->left = (int16_t) left;
+    bounds->top = (int16_t) top;
+    bounds->width = (int16_t) (union_right - left);
+    bounds->height = (int16_t) (union_bottom - top);
+    return true;
 }
 
 void video_fill_rect(color_t color, rect_t rect) {
-    if (s_current_pre_command >= PRE_COMMANDS_MAX - 1)
+    if (rect.width <= 0 || rect.height <= 0)
+        return;
+
+    vid_rect_data_t* last = cmd_stream_last(&s_pre_commands, vid_pre_rect);
+    if (last != NULL && last->fill && video_fill_merge(last, &color, &rect)) {
+        s_merged_fills++;
+        return;
+    }
+
+    vid_rect_data_t* vid_rect = cmd_stream_push(&s_pre_commands, vid_pre_rect, sizeof(vid_rect_data_t));
+    if (vid_rect == NULL)
         return;
 
-    s_pre_commands[s_current_pre_command].type = vid_pre_rect;
-    s_pre_commands[s_current_pre_command].data.rect.fill = true;
-    s_pre_commands[s_current_pre_command].data.rect.color = color;
-    s_pre_commands[s_current_pre_command].data.rect.bounds = rect;
-    ++s_current_pre_command;
+    vid_rect->fill = true;
+    vid_rect->color = color;
+    vid_rect->bounds = rect;
 }
 
 void video_vline(color_t color, uint16_t y, uint16_t x, uint16_t h) {
-    if (s_current_pre_command >= PRE_COMMANDS_MAX - 1)
+    vid_vline_data_t* line = cmd_stream_push(&s_pre_commands, vid_pre_vline, sizeof(vid_vline_data_t));
+    if (line == NULL)
         return;
 
-    vid_vline_data_t line = {
-        .color = color,
-        .x = x,
-        .y = y,
-        .h = h
-    };
-    s_pre_commands[s_current_pre_command].type = vid_pre_vline;
-    s_pre_commands[s_current_pre_command].data.vline = line;
-    ++s_current_pre_command;
+    line->color = color;
+    line->x = x;
+    line->y = y;
+    line->h = h;
 }
 
 void video_hline(color_t color, uint16_t y, uint16_t x, uint16_t w) {
-    if (s_current_pre_command >= PRE_COMMANDS_MAX - 1)
+    vid_hline_data_t* line = cmd_stream_push(&s_pre_commands, vid_pre_hline, sizeof(vid_hline_data_t));
+    if (line == NULL)
         return;
 
-    s_pre_commands[s_current_pre_command].type = vid_pre_hline;
-
-    vid_hline_data_t line = {
-        .color = color,
-        .x = x,
-        .y = y,
-        .w = w
-    };
-    s_pre_commands[s_current_pre_command].data.hline = line;
-    ++s_current_pre_command;
+    line->color = color;
+    line->x = x;
+    line->y = y;
+    line->w = w;
 }
 
 void video_bg_pal_rect(rect_t rect, uint8_t palette) {
@@ -614,9 +2514,10 @@ void video_bg_pal_rect(rect_t rect, uint8_t palette) {
             uint32_t index = (uint32_t) (y * TILE_MAP_WIDTH + x);
             bg_control_block_t* block = &s_bg_control[index];
             block->palette = palette;
-            block->flags |= f_bg_enabled | f_bg_changed;
+            block->flags |= f_bg_enabled;
         }
     }
+    video_bg_mark_rect(rect);
 }
 
 void video_bg_fill_rect(rect_t rect, uint16_t tile, int8_t palette) {
@@ -627,46 +2528,50 @@ void video_bg_fill_rect(rect_t rect, uint16_t tile, int8_t palette) {
             block->tile = tile;
             if (palette > 0)
                 block->palette = palette;
-            block->flags |= f_bg_enabled | f_bg_changed;
+            block->flags |= f_bg_enabled;
         }
     }
+    video_bg_mark_rect(rect);
 }
 
 void video_text(color_t color, uint16_t y, uint16_t x, const char* fmt, ...) {
-    if (s_current_post_command >= POST_COMMANDS_MAX - 1)
-        return;
-
-    s_post_commands[s_current_post_command].type = vid_post_text;
-
-    vid_text_data_t text = {
-        .color = color,
-        .x = x,
-        .y = y,
-    };
-
     va_list list;
     va_start(list, fmt);
-    vsnprintf(text.buffer, 256, fmt, list);
+    va_list measure;
+    va_copy(measure, list);
+    int length = vsnprintf(NULL, 0, fmt, measure);
+    va_end(measure);
+
+    // the record is sized to the formatted string, clamped to what a
+    // single stream record can hold
+    const uint32_t text_max = CMD_STREAM_RECORD_MAX
+        - (uint32_t) (sizeof(cmd_header_t) + sizeof(vid_text_data_t) + 1);
+    if (length < 0) {
+        va_end(list);
+        return;
+    }
+    if ((uint32_t) length > text_max)
+        length = (int) text_max;
+
+    const uint32_t size = (uint32_t) (sizeof(vid_text_data_t) + length + 1);
+    vid_text_data_t* text = cmd_stream_push(&s_post_commands, vid_post_text, size);
+    if (text != NULL) {
+        text->color = color;
+        text->x = x;
+        text->y = y;
+        vsnprintf(text->buffer, (size_t) length + 1, fmt, list);
+    }
     va_end(list);
-
-    s_post_commands[s_current_post_command].data.text = text;
-    ++s_current_post_command;
 }
 
 void video_stamp_tile(uint16_t y, uint16_t x, uint16_t tile, uint8_t palette, uint8_t flags) {
-    if (s_current_pre_command >= PRE_COMMANDS_MAX - 1)
+    vid_tile_data_t* tile_data = cmd_stream_push(&s_pre_commands, vid_pre_tile, sizeof(vid_tile_data_t));
+    if (tile_data == NULL)
         return;
 
-    s_pre_commands[s_current_pre_command].type = vid_pre_tile;
-
-    vid_tile_data_t tile_data = {
-        .x = x,
-        .y = y,
-        .tile = tile,
-        .flags = flags,
-        .palette = palette,
-    };
-
-    s_pre_commands[s_current_pre_command].data.tile = tile_data;
-    ++s_current_pre_command;
+    tile_data->x = x;
+    tile_data->y = y;
+    tile_data->tile = tile;
+    tile_data->flags = flags;
+    tile_data->palette = palette;
 }
@@ -18,13 +18,15 @@
 #include "fwd.h"
 #include "window.h"
 #include "tile_map.h"
+#include "video_sink.h"
 
-#define PRE_COMMANDS_MAX (1024)
-#define POST_COMMANDS_MAX (256)
+#define COMMAND_BYTES_DEFAULT (64 * 1024)
 #define BLINKERS_MAX (16)
 #define FRAME_RATE (60)
 #define MS_PER_FRAME (1000 / FRAME_RATE)
 #define CURRENT_PALETTE (-1)
+#define SPR_PRIORITY_BEHIND_BG (-128)
+#define SPRITE_VIRTUAL_MAX (65536)
 
 typedef enum {
     f_spr_none     = 0b00000000,
@@ -57,6 +59,28 @@ typedef struct {
     uint8_t a;
 } color_t;
 
+typedef enum {
+    video_renderer_cpu,
+    video_renderer_atlas,
+} video_renderer_t;
+
+typedef struct {
+    uint32_t frames;
+    uint32_t restored_bytes;
+    uint32_t uploaded_bytes;
+    uint32_t restored_total;
+    uint32_t uploaded_total;
+    uint32_t dropped_lines;
+    uint32_t merged_fills;
+    uint32_t command_bytes;
+    uint32_t command_overflows;
+    uint32_t bg_cache_hits;
+    uint32_t bg_cache_misses;
+    uint32_t bg_set_cells;
+    uint32_t sprite_overflows;
+    uint32_t sprite_flickered;
+} video_stats_t;
+
 typedef struct bg_blinker bg_blinker_t;
 typedef bool (*bg_blinker_callback)(bg_blinker_t*, uint32_t);
 
@@ -84,6 +108,7 @@ typedef struct {
     uint16_t tile;
     uint8_t flags;
     uint8_t palette;
+    int8_t priority;
     uint32_t data1;
     uint32_t data2;
 } spr_control_block_t;
@@ -120,18 +145,6 @@ typedef struct {
     uint8_t palette;
 } vid_tile_data_t;
 
-typedef union {
-    vid_rect_data_t rect;
-    vid_tile_data_t tile;
-    vid_hline_data_t hline;
-    vid_vline_data_t vline;
-} vid_pre_command_data_t;
-
-typedef struct {
-    vid_pre_command_type_t type;
-    vid_pre_command_data_t data;
-} vid_pre_command_t;
-
 typedef enum {
     vid_post_none,
     vid_post_text,
@@ -140,18 +153,9 @@ typedef enum {
 typedef struct {
     color_t color;
     uint16_t x, y;
-    char buffer[256];
+    char buffer[];
 } vid_text_data_t;
 
-typedef union {
-    vid_text_data_t text;
-} vid_post_command_data_t;
-
-typedef struct {
-    vid_post_command_type_t type;
-    vid_post_command_data_t data;
-} vid_post_command_t;
-
 void video_bg_str(
     uint8_t y,
     uint8_t x,
@@ -164,6 +168,8 @@ void video_shutdown(void);
 
 void video_bg_reset(void);
 
+void video_raster_clear(void);
+
 bg_blinker_t* video_bg_blink(
     uint8_t y,
     uint8_t x,
@@ -177,28 +183,68 @@ void video_reset_sprites(void);
 
 void video_clip_rect_clear(void);
 
+void video_sprite_limit(uint8_t per_line);
+
+void video_indexed(bool enabled);
+
+void video_zero_copy(bool enabled);
+
+void video_pixel_format(uint32_t format);
+
+bool video_renderer(video_renderer_t type);
+
 void video_clip_rect(rect_t rect);
 
+void video_bg_mark_rect(rect_t rect);
+
+void video_bg_mark(uint8_t y, uint8_t x);
+
+const video_stats_t* video_stats(void);
+
 void video_bg_set(const tile_map_t* map);
 
+void video_scroll(int32_t y, int32_t x);
+
+void video_raster_line(uint8_t y, int16_t scroll_x, int16_t palette);
+
 void video_rect(color_t color, rect_t rect);
 
+void video_palette_changed(uint8_t palette);
+
+const char* video_renderer_name(video_renderer_t type);
+
+void video_tile_bitmap_changed(uint16_t tile);
+
+bool video_renderer_parse(const char* value, video_renderer_t* type);
+
 void video_init(struct SDL_Renderer* renderer);
 
+void video_render_threads(uint32_t count);
+
+void video_command_limit(uint32_t bytes);
+
 void video_fill_rect(color_t color, rect_t rect);
 
 spr_control_block_t* video_sprite(uint8_t number);
 
+spr_control_block_t* video_sprite_virtual(uint32_t number);
+
+spr_control_block_t* const* video_sprite_sort(uint32_t* count);
+
 void video_bg_fill(uint16_t tile, uint8_t palette);
 
-void video_update(window_t* window, uint32_t ticks);
+void video_update(video_sink_t* sink, uint32_t ticks);
 
 bg_control_block_t* video_tile(uint8_t y, uint8_t x);
 
 void video_bg_pal_rect(rect_t rect, uint8_t palette);
 
+void video_bg_playfield_mark(uint16_t y, uint16_t x);
+
 void video_bg_fill_rect(rect_t rect, uint16_t tile, int8_t palette);
 
+void video_bg_playfield(const tile_map_entry_t* data, uint16_t rows, uint16_t cols);
+
 void video_vline(color_t color, uint16_t y, uint16_t x, uint16_t h);
 
 void video_hline(color_t color, uint16_t y, uint16_t x, uint16_t w);
@@ -0,0 +1,191 @@
+// --------------------------------------------------------------------------
+//
+// C Kong
+// Copyright (C) 2018 Jeff Panici
+// All rights reserved.
+//
+// This software source file is licensed according to the
+// MIT License.  Refer to the LICENSE file distributed along
+// with this source file to learn more.
+//
+// --------------------------------------------------------------------------
+
+#include <string.h>
+#include <SDL_hints.h>
+#include <SDL_render.h>
+#include "log.h"
+#include "blit.h"
+#include "tile.h"
+#include "sprite.h"
+#include "palette.h"
+#include "pixel_format.h"
+#include "video_atlas.h"
+
+// each palette gets one atlas: sprites fill the top half as a 16x8 grid,
+// tiles the next quarter as a 32x8 grid.
+#define ATLAS_SPRITE_COLUMNS (VIDEO_ATLAS_WIDTH / SPRITE_WIDTH)
+#define ATLAS_TILE_COLUMNS (VIDEO_ATLAS_WIDTH / TILE_WIDTH)
+#define ATLAS_TILE_TOP ((SPRITE_MAX / ATLAS_SPRITE_COLUMNS) * SPRITE_HEIGHT)
+
+static SDL_Renderer* s_renderer;
+
+static SDL_Texture* s_atlases[PALETTE_MAX];
+
+static video_atlas_stats_t s_stats;
+
+static uint32_t s_pixels[VIDEO_ATLAS_WIDTH * VIDEO_ATLAS_HEIGHT];
+
+SDL_Texture* video_atlas_texture(int32_t access, int32_t width, int32_t height) {
+    // the window asks for linear scaling, which would sample neighboring
+    // atlas cells at every edge; atlas textures scale like the cpu frame.
+    char quality[16];
+    const char* hint = SDL_GetHint(SDL_HINT_RENDER_SCALE_QUALITY);
+    SDL_strlcpy(quality, hint != NULL ? hint : "nearest", sizeof(quality));
+
+    SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "nearest");
+    SDL_Texture* texture = SDL_CreateTexture(s_renderer, pixel_format(), access, width, height);
+    SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, quality);
+    return texture;
+}
+
+static SDL_Texture* atlas_create(uint8_t pal_index) {
+    const pixel_palette_t* native = pixel_format_palette(pal_index);
+    if (native == NULL)
+        return NULL;
+
+    memset(s_pixels, 0, sizeof(s_pixels));
+
+    for (uint16_t tile = 0; tile < SPRITE_MAX; tile++) {
+        const sprite_bitmap_t* bitmap = sprite_bitmap(tile);
+        const uint32_t left = (tile % ATLAS_SPRITE_COLUMNS) * SPRITE_WIDTH;
+        const uint32_t top = (tile / ATLAS_SPRITE_COLUMNS) * SPRITE_HEIGHT;
+        for (uint32_t y = 0; y < SPRITE_HEIGHT; y++) {
+            uint32_t* p = &s_pixels[(top + y) * VIDEO_ATLAS_WIDTH + left];
+            for (uint32_t x = 0; x < SPRITE_WIDTH; x++) {
+                const uint8_t index = (uint8_t) (bitmap->data[y * SPRITE_WIDTH + x] & 0x03);
+                p[x] = native->colors[index];
+            }
+        }
+    }
+
+    for (uint16_t tile = 0; tile < TILE_MAX; tile++) {
+        const tile_bitmap_t* bitmap = tile_bitmap(tile);
+        const uint32_t left = (tile % ATLAS_TILE_COLUMNS) * TILE_WIDTH;
+        const uint32_t top = ATLAS_TILE_TOP + (tile / ATLAS_TILE_COLUMNS) * TILE_HEIGHT;
+        for (uint32_t y = 0; y < TILE_HEIGHT; y++) {
+            uint32_t* p = &s_pixels[(top + y) * VIDEO_ATLAS_WIDTH + left];
+            for (uint32_t x = 0; x < TILE_WIDTH; x++) {
+                const uint8_t index = (uint8_t) (bitmap->data[y * TILE_WIDTH + x] & 0x03);
+                p[x] = native->opaque[index];
+            }
+        }
+    }
+
+    // N.B. same format as the streaming texture the cpu path uploads the
+    // fg surface bytes into, so both paths show the same colors.
+    SDL_Texture* texture = video_atlas_texture(
+        SDL_TEXTUREACCESS_STATIC,
+        VIDEO_ATLAS_WIDTH,
+        VIDEO_ATLAS_HEIGHT);
+    if (texture == NULL) {
+        log_error(category_video, "unable to create atlas texture: %s", SDL_GetError());
+        return NULL;
+    }
+
+    SDL_UpdateTexture(texture, NULL, s_pixels, VIDEO_ATLAS_WIDTH * 4);
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    s_stats.textures++;
+    s_stats.uploads++;
+
+    return texture;
+}
+
+static SDL_Texture* atlas(uint8_t pal_index) {
+    if (pal_index >= PALETTE_MAX)
+        return NULL;
+
+    if (s_atlases[pal_index] == NULL)
+        s_atlases[pal_index] = atlas_create(pal_index);
+
+    return s_atlases[pal_index];
+}
+
+static bool atlas_copy(
+        SDL_Texture* texture,
+        const SDL_Rect* src,
+        const SDL_Rect* dst,
+        uint8_t flags) {
+    SDL_RendererFlip flip = SDL_FLIP_NONE;
+    if ((flags & f_blit_hflip) != 0)
+        flip |= SDL_FLIP_HORIZONTAL;
+    if ((flags & f_blit_vflip) != 0)
+        flip |= SDL_FLIP_VERTICAL;
+
+    s_stats.copies++;
+    if (flip == SDL_FLIP_NONE)
+        return SDL_RenderCopy(s_renderer, texture, src, dst) == 0;
+    return SDL_RenderCopyEx(s_renderer, texture, src, dst, 0, NULL, flip) == 0;
+}
+
+bool video_atlas_init(struct SDL_Renderer* renderer) {
+    video_atlas_shutdown();
+    if (renderer == NULL)
+        return false;
+
+    s_renderer = renderer;
+    memset(&s_stats, 0, sizeof(video_atlas_stats_t));
+    return true;
+}
+
+void video_atlas_shutdown(void) {
+    video_atlas_invalidate();
+    s_renderer = NULL;
+}
+
+void video_atlas_invalidate(void) {
+    for (uint32_t i = 0; i < PALETTE_MAX; i++)
+        video_atlas_invalidate_palette((uint8_t) i);
+}
+
+const video_atlas_stats_t* video_atlas_stats(void) {
+    return &s_stats;
+}
+
+void video_atlas_invalidate_palette(uint8_t palette) {
+    if (palette >= PALETTE_MAX || s_atlases[palette] == NULL)
+        return;
+
+    SDL_DestroyTexture(s_atlases[palette]);
+    s_atlases[palette] = NULL;
+    s_stats.textures--;
+}
+
+bool video_atlas_tile(int32_t x, int32_t y, uint16_t tile, uint8_t palette, uint8_t flags) {
+    SDL_Texture* texture = atlas(palette);
+    if (texture == NULL || tile >= TILE_MAX)
+        return false;
+
+    SDL_Rect src = {
+        (int) ((tile % ATLAS_TILE_COLUMNS) * TILE_WIDTH),
+        (int) (ATLAS_TILE_TOP + (tile / ATLAS_TILE_COLUMNS) * TILE_HEIGHT),
+        TILE_WIDTH,
+        TILE_HEIGHT
+    };
+    SDL_Rect dst = {x, y, TILE_WIDTH, TILE_HEIGHT};
+    return atlas_copy(texture, &src, &dst, flags);
+}
+
+bool video_atlas_sprite(int32_t x, int32_t y, uint16_t tile, uint8_t palette, uint8_t flags) {
+    SDL_Texture* texture = atlas(palette);
+    if (texture == NULL || tile >= SPRITE_MAX)
+        return false;
+
+    SDL_Rect src = {
+        (int) ((tile % ATLAS_SPRITE_COLUMNS) * SPRITE_WIDTH),
+        (int) ((tile / ATLAS_SPRITE_COLUMNS) * SPRITE_HEIGHT),
+        SPRITE_WIDTH,
+        SPRITE_HEIGHT
+    };
+    SDL_Rect dst = {x, y, SPRITE_WIDTH, SPRITE_HEIGHT};
+    return atlas_copy(texture, &src, &dst, flags);
+}
@@ -0,0 +1,42 @@
+// --------------------------------------------------------------------------
+//
+// C Kong
+// Copyright (C) 2018 Jeff Panici
+// All rights reserved.
+//
+// This software source file is licensed according to the
+// MIT License.  Refer to the LICENSE file distributed along
+// with this source file to learn more.
+//
+// --------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "fwd.h"
+
+#define VIDEO_ATLAS_WIDTH (256)
+#define VIDEO_ATLAS_HEIGHT (256)
+
+typedef struct {
+    uint32_t textures;
+    uint32_t copies;
+    uint32_t uploads;
+} video_atlas_stats_t;
+
+void video_atlas_shutdown(void);
+
+void video_atlas_invalidate(void);
+
+const video_atlas_stats_t* video_atlas_stats(void);
+
+void video_atlas_invalidate_palette(uint8_t palette);
+
+bool video_atlas_init(struct SDL_Renderer* renderer);
+
+struct SDL_Texture* video_atlas_texture(int32_t access, int32_t width, int32_t height);
+
+bool video_atlas_tile(int32_t x, int32_t y, uint16_t tile, uint8_t palette, uint8_t flags);
+
+bool video_atlas_sprite(int32_t x, int32_t y, uint16_t tile, uint8_t palette, uint8_t flags);
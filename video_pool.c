@@ -0,0 +1,122 @@
+// --------------------------------------------------------------------------
+//
+// C Kong
+// Copyright (C) 2018 Jeff Panici
+// All rights reserved.
+//
+// This software source file is licensed according to the
+// MIT License.  Refer to the LICENSE file distributed along
+// with this source file to learn more.
+//
+// --------------------------------------------------------------------------
+
+#include <SDL_atomic.h>
+#include <SDL_thread.h>
+#include "log.h"
+#include "video_pool.h"
+
+typedef struct {
+    video_pool_job_t job;
+    void* user;
+    uint32_t count;
+    SDL_atomic_t next;
+} video_pool_batch_t;
+
+static SDL_Thread* s_threads[VIDEO_POOL_MAX];
+static uint32_t s_workers = 0;
+
+static SDL_sem* s_start;
+static SDL_sem* s_done;
+static SDL_atomic_t s_quit;
+
+static video_pool_batch_t s_batch;
+
+static void video_pool_drain(void) {
+    for (;;) {
+        const uint32_t index = (uint32_t) SDL_AtomicAdd(&s_batch.next, 1);
+        if (index >= s_batch.count)
+            break;
+        s_batch.job(s_batch.user, index);
+    }
+}
+
+static int video_pool_worker(void* data) {
+    for (;;) {
+        SDL_SemWait(s_start);
+        if (SDL_AtomicGet(&s_quit) != 0)
+            break;
+        video_pool_drain();
+        SDL_SemPost(s_done);
+    }
+    return 0;
+}
+
+bool video_pool_init(uint32_t workers) {
+    video_pool_shutdown();
+
+    if (workers > VIDEO_POOL_MAX)
+        workers = VIDEO_POOL_MAX;
+    if (workers == 0)
+        return true;
+
+    s_start = SDL_CreateSemaphore(0);
+    s_done = SDL_CreateSemaphore(0);
+    if (s_start == NULL || s_done == NULL) {
+        log_error(category_video, "unable to create worker semaphores: %s", SDL_GetError());
+        video_pool_shutdown();
+        return false;
+    }
+
+    SDL_AtomicSet(&s_quit, 0);
+    for (uint32_t i = 0; i < workers; i++) {
+        s_threads[i] = SDL_CreateThread(video_pool_worker, "video_worker", NULL);
+        if (s_threads[i] == NULL) {
+            log_error(category_video, "unable to create video worker: %s", SDL_GetError());
+            video_pool_shutdown();
+            return false;
+        }
+        s_workers++;
+    }
+
+    log_message(category_video, "video worker pool: %d threads.", s_workers);
+    return true;
+}
+
+void video_pool_shutdown(void) {
+    SDL_AtomicSet(&s_quit, 1);
+    for (uint32_t i = 0; i < s_workers; i++)
+        SDL_SemPost(s_start);
+    for (uint32_t i = 0; i < s_workers; i++) {
+        SDL_WaitThread(s_threads[i], NULL);
+        s_threads[i] = NULL;
+    }
+    s_workers = 0;
+
+    if (s_start != NULL) {
+        SDL_DestroySemaphore(s_start);
+        s_start = NULL;
+    }
+    if (s_done != NULL) {
+        SDL_DestroySemaphore(s_done);
+        s_done = NULL;
+    }
+}
+
+uint32_t video_pool_workers(void) {
+    return s_workers;
+}
+
+void video_pool_run(video_pool_job_t job, void* user, uint32_t count) {
+    s_batch.job = job;
+    s_batch.user = user;
+    s_batch.count = count;
+    SDL_AtomicSet(&s_batch.next, 0);
+
+    // the calling thread works the batch too; the semaphores order the
+    // batch setup before, and every job's writes after, this call.
+    for (uint32_t i = 0; i < s_workers; i++)
+        SDL_SemPost(s_start);
+    video_pool_drain();
+    for (uint32_t i = 0; i < s_workers; i++)
+        SDL_SemWait(s_done);
+}
@@ -0,0 +1,28 @@
+// --------------------------------------------------------------------------
+//
+// C Kong
+// Copyright (C) 2018 Jeff Panici
+// All rights reserved.
+//
+// This software source file is licensed according to the
+// MIT License.  Refer to the LICENSE file distributed along
+// with this source file to learn more.
+//
+// --------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define VIDEO_POOL_MAX (8)
+
+typedef void (*video_pool_job_t)(void*, uint32_t);
+
+void video_pool_shutdown(void);
+
+uint32_t video_pool_workers(void);
+
+bool video_pool_init(uint32_t workers);
+
+void video_pool_run(video_pool_job_t job, void* user, uint32_t count);
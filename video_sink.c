@@ -0,0 +1,203 @@
+// --------------------------------------------------------------------------
+//
+// C Kong
+// Copyright (C) 2018 Jeff Panici
+// All rights reserved.
+//
+// This software source file is licensed according to the
+// MIT License.  Refer to the LICENSE file distributed along
+// with this source file to learn more.
+//
+// --------------------------------------------------------------------------
+
+#include <string.h>
+#include <assert.h>
+#include <SDL_render.h>
+#include "log.h"
+#include "blit.h"
+#include "pixel_format.h"
+#include "video_sink.h"
+
+static void window_upload(video_sink_t* sink, const video_band_t* band) {
+    SDL_Rect rect = {0, band->top, SCREEN_WIDTH, band->height};
+    SDL_UpdateTexture(
+        sink->window->texture,
+        &rect,
+        band->pixels,
+        band->pitch);
+}
+
+static uint8_t* window_lock(video_sink_t* sink, uint16_t top, uint16_t height, int32_t* pitch) {
+    SDL_Rect rect = {0, top, SCREEN_WIDTH, height};
+    void* pixels;
+    if (SDL_LockTexture(sink->window->texture, &rect, &pixels, pitch) != 0) {
+        log_warn(category_video, "SDL_LockTexture failed: %s", SDL_GetError());
+        return NULL;
+    }
+    return pixels;
+}
+
+static void window_unlock(video_sink_t* sink) {
+    SDL_UnlockTexture(sink->window->texture);
+}
+
+static void window_compose(video_sink_t* sink) {
+    SDL_RenderCopy(
+        sink->renderer,
+        sink->window->texture,
+        NULL,
+        NULL);
+}
+
+static void window_present(video_sink_t* sink) {
+    SDL_RenderPresent(sink->renderer);
+    sink->frames++;
+}
+
+static void null_upload(video_sink_t* sink, const video_band_t* band) {
+}
+
+static void null_callback(video_sink_t* sink) {
+}
+
+static void null_present(video_sink_t* sink) {
+    sink->frames++;
+}
+
+static void memory_upload(video_sink_t* sink, const video_band_t* band) {
+    const uint8_t* src = band->pixels;
+    uint8_t* dst = sink->pixels + band->top * sink->pitch;
+    for (uint16_t y = 0; y < band->height; y++) {
+        memcpy(dst, src, SCREEN_WIDTH * 4);
+        src += band->pitch;
+        dst += sink->pitch;
+    }
+}
+
+static uint8_t* memory_lock(video_sink_t* sink, uint16_t top, uint16_t height, int32_t* pitch) {
+    *pitch = sink->pitch;
+    return sink->pixels + top * sink->pitch;
+}
+
+static void scaled_compose(video_sink_t* sink) {
+    SDL_Surface* surface = sink->window->surface;
+    const uint32_t scale = sink->window->scale_x;
+    const blit_target_t src = {.pixels = sink->pixels, .pitch = sink->pitch};
+
+    if (pixel_format_native(surface->format->format) == sink->format
+            && surface->w >= (int) (SCREEN_WIDTH * scale)
+            && surface->h >= (int) (SCREEN_HEIGHT * scale)) {
+        SDL_LockSurface(surface);
+        const blit_target_t dst = {.pixels = surface->pixels, .pitch = surface->pitch};
+        blit_scale(&dst, &src, SCREEN_WIDTH, SCREEN_HEIGHT, scale);
+        SDL_UnlockSurface(surface);
+        return;
+    }
+
+    // odd window surface formats go through SDL's converting blitter
+    SDL_Surface* frame = SDL_CreateRGBSurfaceWithFormatFrom(
+        sink->pixels,
+        SCREEN_WIDTH,
+        SCREEN_HEIGHT,
+        32,
+        sink->pitch,
+        sink->format);
+    if (frame == NULL)
+        return;
+    SDL_BlitScaled(frame, NULL, surface, NULL);
+    SDL_FreeSurface(frame);
+}
+
+static void scaled_present(video_sink_t* sink) {
+    SDL_UpdateWindowSurface(sink->window->window);
+    sink->frames++;
+}
+
+void video_sink_free(video_sink_t* sink) {
+    if (sink == NULL)
+        return;
+    free(sink->pixels);
+    free(sink);
+}
+
+const char* video_sink_name(video_sink_type_t type) {
+    switch (type) {
+        case video_sink_window:
+            return "window";
+        case video_sink_null:
+            return "null";
+        case video_sink_memory:
+            return "memory";
+        case video_sink_scaled:
+            return "scaled";
+        default:
+            return "unknown";
+    }
+}
+
+bool video_sink_parse(const char* value, video_sink_type_t* type) {
+    assert(value != NULL);
+    assert(type != NULL);
+
+    for (video_sink_type_t t = video_sink_window; t <= video_sink_scaled; t++) {
+        if (strcmp(value, video_sink_name(t)) == 0) {
+            *type = t;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+video_sink_t* video_sink_new(video_sink_type_t type, window_t* window) {
+    video_sink_t* sink = calloc(1, sizeof(video_sink_t));
+    sink->type = type;
+    // sinks without a window keep the ARGB8888 frames always had
+    sink->format = window != NULL && window->format != 0
+        ? window->format
+        : SDL_PIXELFORMAT_ARGB8888;
+
+    switch (type) {
+        case video_sink_window: {
+            assert(window != NULL);
+            sink->window = window;
+            sink->renderer = window->renderer;
+            sink->upload = window_upload;
+            sink->lock = window_lock;
+            sink->unlock = window_unlock;
+            sink->compose = window_compose;
+            sink->present = window_present;
+            break;
+        }
+        case video_sink_memory: {
+            sink->pitch = SCREEN_WIDTH * 4;
+            sink->pixels = calloc(SCREEN_HEIGHT, (size_t) sink->pitch);
+            sink->upload = memory_upload;
+            sink->lock = memory_lock;
+            sink->unlock = null_callback;
+            sink->compose = null_callback;
+            sink->present = null_present;
+            break;
+        }
+        case video_sink_scaled: {
+            assert(window != NULL);
+            sink->window = window;
+            sink->renderer = window->renderer;
+            sink->pitch = SCREEN_WIDTH * 4;
+            sink->pixels = calloc(SCREEN_HEIGHT, (size_t) sink->pitch);
+            sink->upload = memory_upload;
+            sink->compose = scaled_compose;
+            sink->present = scaled_present;
+            break;
+        }
+        default: {
+            sink->upload = null_upload;
+            sink->compose = null_callback;
+            sink->present = null_present;
+            break;
+        }
+    }
+
+    log_message(category_video, "video sink: %s.", video_sink_name(type));
+    return sink;
+}
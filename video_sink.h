@@ -0,0 +1,61 @@
+// --------------------------------------------------------------------------
+//
+// C Kong
+// Copyright (C) 2018 Jeff Panici
+// All rights reserved.
+//
+// This software source file is licensed according to the
+// MIT License.  Refer to the LICENSE file distributed along
+// with this source file to learn more.
+//
+// --------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "fwd.h"
+#include "window.h"
+
+typedef enum {
+    video_sink_window,
+    video_sink_null,
+    video_sink_memory,
+    video_sink_scaled,
+} video_sink_type_t;
+
+typedef struct {
+    const uint8_t* pixels;
+    int32_t pitch;
+    uint16_t top;
+    uint16_t height;
+} video_band_t;
+
+typedef struct video_sink video_sink_t;
+
+typedef void (*video_sink_upload_t)(video_sink_t*, const video_band_t*);
+typedef void (*video_sink_callback_t)(video_sink_t*);
+typedef uint8_t* (*video_sink_lock_t)(video_sink_t*, uint16_t, uint16_t, int32_t*);
+
+typedef struct video_sink {
+    video_sink_type_t type;
+    uint32_t frames;
+    int32_t pitch;
+    uint32_t format;
+    uint8_t* pixels;
+    window_t* window;
+    struct SDL_Renderer* renderer;
+    video_sink_upload_t upload;
+    video_sink_lock_t lock;
+    video_sink_callback_t unlock;
+    video_sink_callback_t compose;
+    video_sink_callback_t present;
+} video_sink_t;
+
+void video_sink_free(video_sink_t* sink);
+
+const char* video_sink_name(video_sink_type_t type);
+
+bool video_sink_parse(const char* value, video_sink_type_t* type);
+
+video_sink_t* video_sink_new(video_sink_type_t type, window_t* window);
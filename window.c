@@ -14,11 +14,25 @@
 #include "window.h"
 #include "str.h"
 #include "log.h"
+#include "pixel_format.h"
+
+static void window_position(window_t* result) {
+    int wx, wy;
+    SDL_GetWindowPosition(result->window, &wx, &wy);
+    result->x = (uint32_t) wx;
+    result->y = (uint32_t) wy;
+    log_message(category_video, "window position: x=%d, y=%d", result->x, result->y);
+    log_message(category_video,
+                "window size: w=%d, h=%d",
+                result->width * result->scale_x,
+                result->height * result->scale_y);
+}
 
 window_t window_create(int32_t y, int32_t x) {
     window_t result;
     result.valid = false;
     result.messages = ll_new_node();
+    result.format = SDL_PIXELFORMAT_ARGB8888;
 
     log_message(category_video, "create SDL window.");
     result.scale_x = SCALE_X;
@@ -52,16 +66,19 @@ window_t window_create(int32_t y, int32_t x) {
         return result;
     }
 
+    // frames are drawn in the texture's own layout, so uploads are copies
+    result.format = pixel_format_negotiate(result.renderer);
     result.texture = SDL_CreateTexture(
         result.renderer,
-        SDL_PIXELFORMAT_ARGB8888,
+        result.format,
         SDL_TEXTUREACCESS_STREAMING,
         SCREEN_WIDTH,
         SCREEN_HEIGHT);
     log_message(category_video,
-                "SDL streaming texture: w=%d, h=%d",
+                "SDL streaming texture: w=%d, h=%d, format=%s",
                 SCREEN_WIDTH,
-                SCREEN_HEIGHT);
+                SCREEN_HEIGHT,
+                SDL_GetPixelFormatName(result.format));
 
     SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "linear");
     SDL_RenderSetLogicalSize(
@@ -76,15 +93,61 @@ window_t window_create(int32_t y, int32_t x) {
                 SCREEN_WIDTH,
                 SCREEN_HEIGHT);
 
-    int wx, wy;
-    SDL_GetWindowPosition(result.window, &wx, &wy);
-    result.x = (uint32_t) wx;
-    result.y = (uint32_t) wy;
-    log_message(category_video, "window position: x=%d, y=%d", result.x, result.y);
+    window_position(&result);
+
+    result.valid = true;
+    return result;
+}
+
+window_t window_create_surface(int32_t y, int32_t x, uint32_t scale) {
+    window_t result;
+    result.valid = false;
+    result.messages = ll_new_node();
+    result.format = SDL_PIXELFORMAT_ARGB8888;
+    result.texture = NULL;
+    result.renderer = NULL;
+
+    log_message(category_video, "create SDL window: %dx integer scale.", scale);
+    result.scale_x = scale;
+    result.scale_y = scale;
+    result.width = SCREEN_WIDTH;
+    result.height = SCREEN_HEIGHT;
+    result.window = SDL_CreateWindow(
+        "C11 Kong",
+        x == -1 ? SDL_WINDOWPOS_CENTERED : x,
+        y == -1 ? SDL_WINDOWPOS_CENTERED : y,
+        result.width * result.scale_x,
+        result.height * result.scale_y,
+        SDL_WINDOW_SHOWN);
+
+    if (result.window == NULL) {
+        result.messages->data = str_clone("unable to create SDL window.");
+        return result;
+    }
+
+    // frames are upscaled straight into the window surface; the software
+    // renderer only draws the text post-commands on top.
+    result.surface = SDL_GetWindowSurface(result.window);
+    if (result.surface == NULL) {
+        result.messages->data = str_clone("unable to get SDL window surface.");
+        return result;
+    }
     log_message(category_video,
-                "window size: w=%d, h=%d",
-                result.width * result.scale_x,
-                result.height * result.scale_y);
+                "window surface format: %s.",
+                SDL_GetPixelFormatName(result.surface->format->format));
+    result.format = pixel_format_native(result.surface->format->format);
+    if (result.format == SDL_PIXELFORMAT_UNKNOWN)
+        result.format = SDL_PIXELFORMAT_ARGB8888;
+
+    log_message(category_video, "create SDL renderer: software, window surface.");
+    result.renderer = SDL_CreateSoftwareRenderer(result.surface);
+    if (result.renderer == NULL) {
+        result.messages->data = str_clone("unable to create SDL software renderer.");
+        return result;
+    }
+    SDL_RenderSetScale(result.renderer, (float) scale, (float) scale);
+
+    window_position(&result);
 
     result.valid = true;
     return result;
@@ -30,6 +30,7 @@ typedef struct {
     uint32_t height;
     uint32_t scale_x;
     uint32_t scale_y;
+    uint32_t format;
     ll_node_t* messages;
     struct SDL_Window* window;
     struct SDL_Surface* surface;
@@ -38,3 +39,5 @@ typedef struct {
 } window_t;
 
 window_t window_create(int32_t y, int32_t x);
+
+window_t window_create_surface(int32_t y, int32_t x, uint32_t scale);